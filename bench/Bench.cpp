@@ -0,0 +1,429 @@
+/*
+* Microbenchmarks of the hot paths of the physics and the drawing, with the
+* results as JSON on stdout so runs can be compared by a script.
+*
+* Every benchmark repeats one operation for at least a fifth of a second
+* after a short warm up and reports the average time of one operation as
+* ns_per_step and its inverse as steps_per_sec. An operation is:
+*	step_*: one World::step of the given time step. step_break starts from
+*		the standard rack hit at full power (16 balls, both engines;
+*		step_break_slide_roll with MOTION_SLIDE_ROLL and the adaptive
+*		stepper),
+*		step_cluster_rest is a packed ball pit with every ball stopped and
+*		step_sparse the same number of balls rolling on a table 16 times
+*		as large. The state is restored every 50 steps, so the break is
+*		measured over its first 50 steps.
+*	batch_*: the same with a TableBatch, per table and step. batch_break
+*		steps batch_lanes copies of the break together. shots and
+*		batch_shots play random shots from the rack to rest, one World at
+*		a time or batch_lanes at once with every lane that stops given
+*		the next shot, and count every step of every table.
+*	collide, collision_point: one call for a pair of overlapping balls.
+*	collide_with_pockets: Table::sweep of every ball of a ball pit over
+*		frame_time, in which every fourth ball reaches a cushion.
+*	predict_ball: World::predictBall of every ball of a rolling ball pit
+*		with MOTION_SLIDE_ROLL, a second ahead.
+*	find_overlaps: one narrow phase query of every ball against all
+*		others.
+*	vec2_ops: normalized, dot and perpendicular on every ball's offset
+*		from the table center.
+*	draw_*: (only with EGL) drawScene() of the viewer into an offscreen
+*		context up to glFinish(), with the static layer cached or drawn
+*		again every frame.
+*
+* Usage: billiard_bench [balls] [time step]
+* The ball count (default 256) applies to everything but the break, the time
+* step (default frame_time) to the step_* benchmarks.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <unistd.h>
+#include "World.h"
+#include "NarrowPhase.h"
+#include "ShotSearch.h"
+#include "TableBatch.h"
+#include "Vec.h"
+
+#ifdef BILLIARD_BENCH_DRAW
+#include "Billiard.h"
+#include "OffscreenContext.h"
+#include "StaticLayer.h"
+
+// the table cache of drawScene(), see Billiard.cpp
+extern StaticLayer staticLayer;
+#endif
+
+const int steps_per_restore = 50;
+
+// results are added here so the compiler cannot drop the work
+volatile double sink;
+
+// the JSON goes to the real stdout, whatever else is printed to stderr
+FILE *out = stdout;
+
+bool firstResult = true;
+
+/*
+* Print one result as an element of the "results" array.
+*/
+void report(const char *name, double nsPerStep, long long steps)
+{
+	fprintf(out, "%s\n    {\"name\": \"%s\", \"ns_per_step\": %.1f, "
+		"\"steps_per_sec\": %.1f, \"steps\": %lld}",
+		firstResult ? "" : ",", name, nsPerStep, 1e9 / nsPerStep, steps);
+	firstResult = false;
+	fflush(out);
+}
+
+/*
+* Run op until a fifth of a second has passed and report the average time
+* of one call. op returns the number of operations it did.
+*/
+template <typename Op>
+void measure(const char *name, Op op)
+{
+	for (int i = 0; i < 10; i++)
+	{
+		op();
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	double elapsed = 0.0;
+	long long steps = 0;
+
+	while (elapsed < 0.2)
+	{
+		for (int i = 0; i < 10; i++)
+		{
+			steps += op();
+		}
+		elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	report(name, elapsed * 1e9 / steps, steps);
+}
+
+/*
+* Step the world from start, going back there every steps_per_restore steps.
+*/
+void measureSteps(const char *name, World &world, float timeStep)
+{
+	WorldSnapshot start;
+	world.snapshot(start);
+	int steps = 0;
+
+	measure(name, [&]() {
+		if (steps == steps_per_restore)
+		{
+			world.restore(start);
+			steps = 0;
+		}
+		sink = world.step(timeStep);
+		steps++;
+		return 1;
+	});
+}
+
+/*
+* Length of a square-ish table that fits numOfBalls balls of the ball pit,
+* as in billiard_broadphase_bench.
+*/
+float pitLength(int numOfBalls)
+{
+	const float spacing = 2 * ball_radius + 0.002f;
+	return spacing * (sqrt(numOfBalls * 8.0f / 3.0f) + 2);
+}
+
+/*
+* A copy of the balls of world with every ball stopped.
+*/
+BallSystem stopped(const World &world)
+{
+	BallSystem balls = world.getBalls();
+
+	for (int i = 0; i < balls.size(); i++)
+	{
+		balls.vx[i] = balls.vy[i] = 0.0f;
+	}
+
+	return balls;
+}
+
+void benchSteps(int numOfBalls, float timeStep)
+{
+	World rack;
+	rack.shoot(90, 1.0f);
+	measureSteps("step_break", rack, timeStep);
+
+	rack.setup();
+	rack.setEngine(ENGINE_EVENT_DRIVEN);
+	rack.shoot(90, 1.0f);
+	measureSteps("step_break_event", rack, timeStep);
+
+	rack.setup();
+	rack.setEngine(ENGINE_ADAPTIVE_STEP);
+	rack.setMotion(MOTION_SLIDE_ROLL);
+	rack.shoot(90, 1.0f);
+	measureSteps("step_break_slide_roll", rack, timeStep);
+
+	World cluster(pitLength(numOfBalls));
+	cluster.setupBallPit(numOfBalls, 42);
+	cluster.restoreBalls(stopped(cluster), false);
+	measureSteps("step_cluster_rest", cluster, timeStep);
+
+	// the same balls four times as far apart: laid out on the small table,
+	// then spread over the large one
+	World pit(pitLength(numOfBalls));
+	pit.setupBallPit(numOfBalls, 42);
+	World sparse(4 * pitLength(numOfBalls));
+	BallSystem balls = pit.getBalls();
+	for (int i = 0; i < balls.size(); i++)
+	{
+		balls.x[i] = balls.lastX[i] = 4 * balls.x[i];
+		balls.y[i] = balls.lastY[i] = 4 * balls.y[i];
+	}
+	sparse.restoreBalls(balls, false);
+	measureSteps("step_sparse", sparse, timeStep);
+}
+
+void benchBatch(float timeStep)
+{
+	World rack;
+	rack.shoot(90, 1.0f);
+
+	TableBatch batch;
+	int steps = steps_per_restore;
+	measure("batch_break", [&]() {
+		if (steps == steps_per_restore)
+		{
+			for (int lane = 0; lane < batch_lanes; lane++)
+			{
+				batch.load(lane, rack);
+			}
+			steps = 0;
+		}
+		sink = batch.step(timeStep);
+		steps++;
+		return batch_lanes;
+	});
+
+	World start;
+	int shot = 0;
+	measure("shots", [&]() {
+		World world = start;
+		Shot next = candidateShot(1, shot++);
+		world.shoot(next.angle, next.power);
+		return world.runUntilRest(timeStep, 100000);
+	});
+
+	for (int lane = 0; lane < batch_lanes; lane++)
+	{
+		batch.clear(lane);
+	}
+	shot = 0;
+	measure("batch_shots", [&]() {
+		for (int lane = 0; lane < batch_lanes; lane++)
+		{
+			if (!batch.isMoving(lane))
+			{
+				Shot next = candidateShot(1, shot++);
+				batch.load(lane, start);
+				batch.shoot(lane, next.angle, next.power);
+			}
+		}
+		sink = batch.step(timeStep);
+		return batch_lanes;
+	});
+}
+
+void benchCollisions()
+{
+	// two balls closing in head on, overlapping by a millimeter
+	BallSystem pair;
+	pair.resize(2);
+	const float start[2][4] = {
+		{1.0f, 0.5f, 0.5f, 0.1f},
+		{1.0f + 2 * ball_radius - 0.001f, 0.5f, -0.5f, 0.0f}
+	};
+
+	auto reset = [&]() {
+		for (int i = 0; i < 2; i++)
+		{
+			pair.x[i] = start[i][0];
+			pair.y[i] = start[i][1];
+			pair.vx[i] = start[i][2];
+			pair.vy[i] = start[i][3];
+			pair.radius[i] = ball_radius;
+		}
+	};
+
+	measure("collide", [&]() {
+		reset();
+		collide(pair, 0, 1, frame_time);
+		sink = pair.vx[0];
+		return 1;
+	});
+
+	const real distance = 2 * ball_radius - 0.001f;
+	measure("collision_point", [&]() {
+		reset();
+		sink = collisionPoint(pair, 0, 1, frame_time, distance,
+			2 * ball_radius);
+		return 1;
+	});
+}
+
+void benchKernels(int numOfBalls)
+{
+	World crowd(pitLength(numOfBalls));
+	crowd.setupBallPit(numOfBalls, 42);
+
+	// every fourth ball next to a cushion, halfway between the pockets,
+	// heading into it
+	const Table &table = crowd.getTable();
+	BallSystem balls = crowd.getBalls();
+	for (int i = 0; i < balls.size(); i += 4)
+	{
+		balls.x[i] = balls.radius[i] * 1.5f;
+		balls.y[i] = table.width / 2;
+		balls.vx[i] = -max_cue_speed;
+	}
+	crowd.restoreBalls(balls, false);
+
+	// the balls are moved on copies, so every call starts from the same state
+	const int n = crowd.numOfBalls();
+	measure("collide_with_pockets", [&]() {
+		float moved = 0.0f;
+		bool scratched = false;
+		for (int i = 0; i < n; i++)
+		{
+			float x = balls.x[i];
+			float y = balls.y[i];
+			float vx = balls.vx[i];
+			float vy = balls.vy[i];
+			if (!table.sweep(x, y, balls.radius[i], vx, vy, frame_time, 1.0f,
+				balls.id[i] == 0, scratched))
+			{
+				moved += x + y;
+			}
+		}
+		sink = moved;
+		return 1;
+	});
+
+	World rolling = crowd;
+	rolling.setMotion(MOTION_SLIDE_ROLL);
+	measure("predict_ball", [&]() {
+		float sum = 0.0f;
+		for (int i = 0; i < n; i++)
+		{
+			float x, y, vx, vy;
+			rolling.predictBall(i, 1.0f, x, y, vx, vy);
+			sum += x + y;
+		}
+		sink = sum;
+		return 1;
+	});
+
+	const BallSystem &pit = crowd.getBalls();
+	std::vector<int> hits(n + 1);
+	measure("find_overlaps", [&]() {
+		int found = 0;
+		for (int i = 0; i < n; i++)
+		{
+			found += findOverlaps(pit, i, i + 1, n, &hits[0]);
+		}
+		sink = found;
+		return 1;
+	});
+
+	const Vec2<real> center(crowd.getTable().length / 2,
+		crowd.getTable().width / 2);
+	measure("vec2_ops", [&]() {
+		real sum = 0;
+		for (int i = 0; i < n; i++)
+		{
+			Vec2<real> offset = Vec2<real>(pit.x[i], pit.y[i]) - center;
+			Vec2<real> direction = normalized(offset);
+			sum += dot(direction, perpendicular(offset)) +
+				dot(direction, offset);
+		}
+		sink = sum;
+		return 1;
+	});
+}
+
+#ifdef BILLIARD_BENCH_DRAW
+void benchDrawing(int numOfBalls)
+{
+	OffscreenContext context;
+	if (!context.create(window_width, window_height))
+	{
+		return;
+	}
+
+	glViewport(0, 0, window_width, window_height);
+	setupRenderingContext();
+
+	World world;
+	TableFrame frame;
+	frame.capture(world);
+	measure("draw_rack", [&]() {
+		drawScene(frame, 1.0f);
+		glFinish();
+		return 1;
+	});
+
+	world.setupBallPit(numOfBalls, 42);
+	frame.capture(world);
+	measure("draw_pit", [&]() {
+		drawScene(frame, 1.0f);
+		glFinish();
+		return 1;
+	});
+
+	measure("draw_pit_uncached", [&]() {
+		staticLayer.invalidate();
+		drawScene(frame, 1.0f);
+		glFinish();
+		return 1;
+	});
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+	int numOfBalls = argc > 1 ? atoi(argv[1]) : 256;
+	float timeStep = argc > 2 ? atof(argv[2]) : frame_time;
+	if (numOfBalls < 2)
+	{
+		numOfBalls = 2;
+	}
+
+	int fd = dup(fileno(stdout));
+	if (fd >= 0 && dup2(fileno(stderr), fileno(stdout)) >= 0)
+	{
+		out = fdopen(fd, "w");
+	}
+
+	fprintf(out, "{\n  \"balls\": %d,\n  \"time_step\": %g,\n  \"real\": \"%s\",\n"
+		"  \"overlap_kernel\": \"%s\",\n  \"results\": [",
+		numOfBalls, timeStep, sizeof(real) == sizeof(double) ? "double" :
+		"float", overlapKernelName());
+
+	benchSteps(numOfBalls, timeStep);
+	benchBatch(timeStep);
+	benchCollisions();
+	benchKernels(numOfBalls);
+#ifdef BILLIARD_BENCH_DRAW
+	benchDrawing(numOfBalls);
+#endif
+
+	fprintf(out, "\n  ]\n}\n");
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+* Compares the broad phases on ball pits of growing size and reports where
+* the grid and sweep and prune start to beat brute force.
+*
+* The table grows with the number of balls so the density stays the same.
+* Usage: billiard_broadphase_bench [max balls]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include "World.h"
+
+const BroadPhaseType types[] = {
+	BROAD_PHASE_BRUTE_FORCE,
+	BROAD_PHASE_GRID,
+	BROAD_PHASE_SWEEP_AND_PRUNE
+};
+const int num_of_types = 3;
+
+const char *broadPhaseName(BroadPhaseType type)
+{
+	static const Table table(table_length);
+	BroadPhase *phase = BroadPhase::create(type, table, ball_radius);
+	const char *name = phase->name();
+	delete phase;
+	return name;
+}
+
+/*
+* Average time of one step in nanoseconds. Runs for at least a fifth of a
+* second after a short warm up. The pit is put back before every ten steps,
+* so the balls keep moving: once they rest, the fixed stepper skips them
+* and no broad phase has anything left to do.
+*/
+double timeStep(int numOfBalls, BroadPhaseType type)
+{
+	// the ball pit lattice has (length / spacing)^2 / 2 slots, use 3/4 of them
+	const float spacing = 2 * ball_radius + 0.002f;
+	float length = spacing * (sqrt(numOfBalls * 8.0f / 3.0f) + 2);
+
+	World world(length);
+	world.setBroadPhase(type);
+	world.setupBallPit(numOfBalls, 42);
+
+	WorldSnapshot pit;
+	world.snapshot(pit);
+
+	for (int i = 0; i < 10; i++)
+	{
+		world.step(frame_time);
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	double elapsed = 0.0;
+	long steps = 0;
+
+	while (elapsed < 0.2)
+	{
+		world.restore(pit);
+		for (int i = 0; i < 10; i++)
+		{
+			world.step(frame_time);
+		}
+		steps += 10;
+		elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	return elapsed * 1e9 / steps;
+}
+
+int main(int argc, char *argv[])
+{
+	int maxBalls = argc > 1 ? atoi(argv[1]) : 4096;
+	int crossover[num_of_types] = {0, 0, 0};
+
+	printf("%8s", "balls");
+	for (int t = 0; t < num_of_types; t++)
+	{
+		printf(" %18s", broadPhaseName(types[t]));
+	}
+	printf("   (ns/step)\n");
+
+	for (int n = 16; n <= maxBalls; n *= 2)
+	{
+		double ns[num_of_types];
+
+		printf("%8d", n);
+		for (int t = 0; t < num_of_types; t++)
+		{
+			ns[t] = timeStep(n, types[t]);
+			printf(" %18.0f", ns[t]);
+
+			if (t > 0 && !crossover[t] && ns[t] < ns[0])
+			{
+				crossover[t] = n;
+			}
+		}
+		printf("\n");
+	}
+
+	for (int t = 1; t < num_of_types; t++)
+	{
+		if (crossover[t])
+			printf("%s beats brute force from %d balls\n",
+				broadPhaseName(types[t]), crossover[t]);
+		else
+			printf("%s never beats brute force up to %d balls\n",
+				broadPhaseName(types[t]), maxBalls);
+	}
+
+	return 0;
+}
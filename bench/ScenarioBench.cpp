@@ -0,0 +1,413 @@
+/*
+* Plays a corpus of typical shots with every engine and time step and
+* compares the outcome against a reference run at a very small time step,
+* to find the cheapest configuration that is still accurate enough.
+*
+* The scenarios are the standard rack broken at three powers, long banks of
+* a lone ball over several cushions, a dense cluster of rolling balls and
+* cut shots that just catch the jaw of a corner pocket. The reference plays
+* each one with the fixed stepper at frame_time / 256 until every ball has
+* stopped (or max_seconds); every configuration then plays the same stretch
+* of game time.
+*
+* For each configuration and scenario it prints
+*	ms: wall time of the whole run
+*	steps: calls to World::step
+*	energy: the largest difference of the total kinetic energy from the
+*		reference at the same game time, in percent of the starting energy
+*	mean, max: the distance of the final positions from the reference, in
+*		millimeters, over the balls that are on the table in both runs
+*	pocketed: the number of balls pocketed in one run but not the other
+* and the cheapest configuration that ends within the tolerance of the
+* reference with the same balls pocketed. Small differences grow quickly in
+* a crowd of colliding balls, so no configuration may pass every scenario;
+* the summary counts the scenarios each one passes and picks the cheapest
+* of those that pass the most.
+*
+* Usage: billiard_scenario_bench [tolerance in mm] [reference substeps]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "FrameScheduler.h"
+#include "World.h"
+
+// the energies are compared this often, a multiple of every time step
+const float sample_time = 8 * frame_time;
+const float max_seconds = 60.0f;
+
+struct Scenario
+{
+	const char *name;
+	void (*setup)(World &world);
+};
+
+struct Config
+{
+	const char *name;
+	EngineType engine;
+	float timeStep;
+};
+
+/*
+* The result of playing a scenario.
+*/
+struct Outcome
+{
+	BallSystem balls;
+	std::vector<double> energy; // at every sample_time
+	int steps;
+	double seconds;
+};
+
+/*****************************************************************************
+							Scenarios
+******************************************************************************/
+
+/*
+* Shooting angle in degrees (see World::shoot) from (x, y) towards (tx, ty).
+*/
+float angleTowards(float x, float y, float tx, float ty)
+{
+	return atan2(tx - x, ty - y) * 180.0f / 3.14159265f;
+}
+
+void breakSoft(World &world)
+{
+	world.setup();
+	world.shoot(90, 0.5f);
+}
+
+void breakMedium(World &world)
+{
+	world.setup();
+	world.shoot(90, 0.75f);
+}
+
+void breakFull(World &world)
+{
+	world.setup();
+	world.shoot(90, 1.0f);
+}
+
+/*
+* A lone ball sent at speed, faster than a cue can, so that it runs along
+* many cushions before it stops.
+*/
+void bank(World &world, float angle, float speed)
+{
+	world.setup(1);
+
+	BallSystem balls = world.getBalls();
+	balls.vx[0] = sin(angle * 3.14159265f / 180.0f) * speed;
+	balls.vy[0] = cos(angle * 3.14159265f / 180.0f) * speed;
+	world.restoreBalls(balls, false);
+}
+
+void bankShallow(World &world)
+{
+	bank(world, 70, 2.0f);
+}
+
+void bankSteep(World &world)
+{
+	bank(world, 25, 2.0f);
+}
+
+/*
+* 200 balls packed in rows at the top of the table, rolling in random
+* directions.
+*/
+void cluster(World &world)
+{
+	world.setBroadPhase(BROAD_PHASE_GRID);
+	world.setupBallPit(200, 7);
+}
+
+/*
+* Cue ball and object ball lined up on the top right pocket, with the cue
+* ball aimed off the straight line by the given angle so the object ball
+* heads for the jaw.
+*/
+void jaw(World &world, float offset)
+{
+	world.setup(2);
+
+	const Table &table = world.getTable();
+	const float objectX = table.length - 0.15f;
+	const float objectY = 0.12f;
+	float dx = table.length - objectX;
+	float dy = 0 - objectY;
+	float distance = sqrt(dx * dx + dy * dy);
+
+	BallSystem balls = world.getBalls();
+	balls.x[1] = balls.lastX[1] = objectX;
+	balls.y[1] = balls.lastY[1] = objectY;
+	balls.x[0] = balls.lastX[0] = objectX - 0.5f * dx / distance;
+	balls.y[0] = balls.lastY[0] = objectY - 0.5f * dy / distance;
+	world.restoreBalls(balls, false);
+
+	world.shoot(angleTowards(balls.x[0], balls.y[0], objectX, objectY) +
+		offset, 0.6f);
+}
+
+void jawStraight(World &world)
+{
+	jaw(world, 0.0f);
+}
+
+void jawThin(World &world)
+{
+	jaw(world, 2.0f);
+}
+
+void jawThinner(World &world)
+{
+	jaw(world, 4.0f);
+}
+
+const Scenario scenarios[] = {
+	{"break_soft", breakSoft},
+	{"break_medium", breakMedium},
+	{"break_full", breakFull},
+	{"bank_shallow", bankShallow},
+	{"bank_steep", bankSteep},
+	{"cluster_200", cluster},
+	{"jaw_straight", jawStraight},
+	{"jaw_2deg", jawThin},
+	{"jaw_4deg", jawThinner}
+};
+const int num_of_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+const Config configs[] = {
+	{"fixed 8x", ENGINE_FIXED_STEP, 8 * frame_time},
+	{"fixed 4x", ENGINE_FIXED_STEP, 4 * frame_time},
+	{"fixed 2x", ENGINE_FIXED_STEP, 2 * frame_time},
+	{"fixed 1x", ENGINE_FIXED_STEP, frame_time},
+	{"fixed 1/2", ENGINE_FIXED_STEP, frame_time / 2},
+	{"fixed 1/4", ENGINE_FIXED_STEP, frame_time / 4},
+	{"fixed 1/8", ENGINE_FIXED_STEP, frame_time / 8},
+	{"adaptive 8x", ENGINE_ADAPTIVE_STEP, 8 * frame_time},
+	{"adaptive 1x", ENGINE_ADAPTIVE_STEP, frame_time},
+	{"event 1x", ENGINE_EVENT_DRIVEN, frame_time}
+};
+const int num_of_configs = sizeof(configs) / sizeof(configs[0]);
+
+/*****************************************************************************
+							Measuring
+******************************************************************************/
+
+double kineticEnergy(const World &world)
+{
+	const BallSystem &balls = world.getBalls();
+	double energy = 0.0;
+
+	// all balls weigh the same, so the mass is left out
+	for (int i = 0; i < balls.size(); i++)
+	{
+		if (balls.active[i])
+		{
+			energy += 0.5 * (balls.vx[i] * balls.vx[i] +
+				balls.vy[i] * balls.vy[i]);
+		}
+	}
+
+	return energy;
+}
+
+/*
+* Play a scenario with one configuration for numOfSamples * sample_time
+* seconds, or until the balls stop if numOfSamples is negative.
+*/
+Outcome play(const Scenario &scenario, EngineType engine, float timeStep,
+			int numOfSamples)
+{
+	World world;
+	world.setEngine(engine);
+	scenario.setup(world);
+
+	const int stepsPerSample = (int) (sample_time / timeStep + 0.5f);
+	const int maxSamples = numOfSamples < 0 ?
+		(int) (max_seconds / sample_time) : numOfSamples;
+
+	Outcome outcome;
+	outcome.energy.push_back(kineticEnergy(world));
+	outcome.steps = 0;
+
+	long long start = monotonicNanoseconds();
+	for (int sample = 0; sample < maxSamples; sample++)
+	{
+		if (numOfSamples < 0 && !world.isMoving())
+		{
+			break;
+		}
+
+		for (int i = 0; i < stepsPerSample; i++)
+		{
+			world.step(timeStep);
+		}
+		outcome.steps += stepsPerSample;
+		outcome.energy.push_back(kineticEnergy(world));
+	}
+	outcome.seconds = (monotonicNanoseconds() - start) * 1e-9;
+
+	outcome.balls = world.getBalls();
+	return outcome;
+}
+
+/*
+* Index of the ball with the given id, or -1.
+*/
+int findBall(const BallSystem &balls, int id)
+{
+	for (int i = 0; i < balls.size(); i++)
+	{
+		if (balls.id[i] == id)
+			return i;
+	}
+
+	return -1;
+}
+
+struct Error
+{
+	double energy; // fraction of the starting energy
+	double meanDistance;
+	double maxDistance;
+	int pocketed;
+};
+
+Error compare(const Outcome &outcome, const Outcome &reference)
+{
+	Error error = {0.0, 0.0, 0.0, 0};
+
+	const double start = reference.energy[0] > 0 ? reference.energy[0] : 1;
+	for (size_t k = 0; k < reference.energy.size() &&
+		k < outcome.energy.size(); k++)
+	{
+		double drift = fabs(outcome.energy[k] - reference.energy[k]) / start;
+		error.energy = drift > error.energy ? drift : error.energy;
+	}
+
+	const BallSystem &balls = outcome.balls;
+	const BallSystem &expected = reference.balls;
+	int compared = 0;
+	for (int i = 0; i < expected.size(); i++)
+	{
+		int j = findBall(balls, expected.id[i]);
+		if (j < 0 || balls.active[j] != expected.active[i])
+		{
+			error.pocketed++;
+			continue;
+		}
+		if (!expected.active[i])
+		{
+			continue;
+		}
+
+		double dx = balls.x[j] - expected.x[i];
+		double dy = balls.y[j] - expected.y[i];
+		double distance = sqrt(dx * dx + dy * dy);
+		error.meanDistance += distance;
+		error.maxDistance = distance > error.maxDistance ?
+			distance : error.maxDistance;
+		compared++;
+	}
+
+	if (compared > 0)
+	{
+		error.meanDistance /= compared;
+	}
+
+	return error;
+}
+
+int main(int argc, char *argv[])
+{
+	double tolerance = (argc > 1 ? atof(argv[1]) : 10.0) * 0.001;
+	int substeps = argc > 2 ? atoi(argv[2]) : 256;
+	if (substeps < 1)
+	{
+		substeps = 1;
+	}
+
+	double worst[num_of_configs] = {0};
+	double totalTime[num_of_configs] = {0};
+	int passed[num_of_configs] = {0};
+
+	for (int s = 0; s < num_of_scenarios; s++)
+	{
+		Outcome reference = play(scenarios[s], ENGINE_FIXED_STEP,
+			frame_time / substeps, -1);
+		const int numOfSamples = (int) reference.energy.size() - 1;
+
+		int pocketed = 0;
+		for (int i = 0; i < reference.balls.size(); i++)
+		{
+			pocketed += !reference.balls.active[i];
+		}
+
+		printf("%s: %d balls, %.1f s of play, %d pocketed, reference %.2f s\n",
+			scenarios[s].name, reference.balls.size(),
+			numOfSamples * sample_time, pocketed, reference.seconds);
+		printf("  %-10s %10s %8s %9s %9s %9s %9s\n", "config", "ms", "steps",
+			"energy %", "mean mm", "max mm", "pocketed");
+
+		int cheapest = -1;
+		double cheapestTime = 0.0;
+		for (int c = 0; c < num_of_configs; c++)
+		{
+			Outcome outcome = play(scenarios[s], configs[c].engine,
+				configs[c].timeStep, numOfSamples);
+			Error error = compare(outcome, reference);
+
+			printf("  %-10s %10.2f %8d %9.3f %9.2f %9.2f %9d\n",
+				configs[c].name, outcome.seconds * 1e3, outcome.steps,
+				error.energy * 100, error.meanDistance * 1e3,
+				error.maxDistance * 1e3, error.pocketed);
+
+			worst[c] = error.maxDistance > worst[c] ?
+				error.maxDistance : worst[c];
+			totalTime[c] += outcome.seconds;
+
+			if (error.maxDistance <= tolerance && error.pocketed == 0)
+			{
+				passed[c]++;
+				if (cheapest < 0 || outcome.seconds < cheapestTime)
+				{
+					cheapest = c;
+					cheapestTime = outcome.seconds;
+				}
+			}
+		}
+
+		if (cheapest >= 0)
+			printf("  cheapest within %.1f mm: %s\n", tolerance * 1e3,
+				configs[cheapest].name);
+		else
+			printf("  no configuration within %.1f mm\n", tolerance * 1e3);
+	}
+
+	printf("\n  %-10s %10s %9s %9s\n", "config", "total ms", "worst mm",
+		"passed");
+	int best = 0;
+	for (int c = 0; c < num_of_configs; c++)
+	{
+		printf("  %-10s %10.2f %9.2f %6d/%d\n", configs[c].name,
+			totalTime[c] * 1e3, worst[c] * 1e3, passed[c], num_of_scenarios);
+
+		if (passed[c] > passed[best] ||
+			(passed[c] == passed[best] && totalTime[c] < totalTime[best]))
+		{
+			best = c;
+		}
+	}
+
+	printf("cheapest of the most accurate: %s, within %.1f mm in %d of %d "
+		"scenarios\n", configs[best].name, tolerance * 1e3, passed[best],
+		num_of_scenarios);
+
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*
+* Times the shot search from the opening rack on 1, 2, 4, ... threads and
+* reports the speedup over one thread, then runs the anytime mode with a
+* short time budget.
+*
+* Usage: billiard_shotsearch_bench [candidates] [max threads]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include "FrameScheduler.h"
+#include "ShotSearch.h"
+
+int main(int argc, char *argv[])
+{
+	ShotSearchOptions options;
+	options.candidates = argc > 1 ? atoi(argv[1]) : 4096;
+	int maxThreads = argc > 2 ? atoi(argv[2]) :
+		(int) std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+	{
+		maxThreads = 1;
+	}
+
+	World world;
+	double single = 0.0;
+
+	printf("%8s %12s %10s %10s\n", "threads", "seconds", "shots/s", "speedup");
+	for (int threads = 1; ; threads *= 2)
+	{
+		if (threads > maxThreads)
+		{
+			threads = maxThreads;
+		}
+
+		ThreadPool pool(threads);
+		long long start = monotonicNanoseconds();
+		ShotResult best = findBestShot(pool, world, options);
+		double seconds = (monotonicNanoseconds() - start) * 1e-9;
+
+		if (threads == 1)
+		{
+			single = seconds;
+			printf("best shot: angle %.1f power %.2f pocketed %d%s\n",
+				best.shot.angle, best.shot.power, best.pocketed,
+				best.scratched ? " (scratch)" : "");
+		}
+
+		printf("%8d %12.3f %10.0f %10.2f\n", threads, seconds,
+			best.evaluated / seconds, single / seconds);
+
+		if (threads == maxThreads)
+		{
+			break;
+		}
+	}
+
+	ThreadPool pool(maxThreads);
+	options.candidates = 1 << 30;
+	options.timeBudget = 0.25;
+	ShotResult best = findBestShot(pool, world, options);
+	printf("anytime, %.2f s budget: %d shots, best pockets %d\n",
+		options.timeBudget, best.evaluated, best.pocketed);
+
+	return 0;
+}
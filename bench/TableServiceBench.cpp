@@ -0,0 +1,91 @@
+/*
+* Plays the same set of games on 1, 2, 4, ... threads with the table
+* service and reports the simulated frames per second of all tables
+* together and the speedup over one thread, plus a summary of the games.
+*
+* Usage: billiard_service_bench [games] [tables per thread] [max threads]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include "FrameScheduler.h"
+#include "TableService.h"
+
+int main(int argc, char *argv[])
+{
+	TableServiceOptions options;
+	options.games = argc > 1 ? atoi(argv[1]) : 2000;
+	options.tablesPerThread = argc > 2 ? atoi(argv[2]) : 4;
+	int maxThreads = argc > 3 ? atoi(argv[3]) :
+		(int) std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+	{
+		maxThreads = 1;
+	}
+
+	double single = 0.0;
+
+	printf("%8s %10s %10s %14s %10s\n", "threads", "seconds", "games",
+		"frames/s", "speedup");
+	for (int threads = 1; ; threads *= 2)
+	{
+		if (threads > maxThreads)
+		{
+			threads = maxThreads;
+		}
+
+		options.threads = threads;
+		TableService service(options);
+
+		long long start = monotonicNanoseconds();
+		service.start();
+
+		int games = 0;
+		long long frames = 0;
+		long long shots = 0;
+		long long pocketed = 0;
+		long long scratches = 0;
+		long long cleared = 0;
+		GameResult result;
+
+		for (bool running = true; running; )
+		{
+			// read the flag first, so nothing pushed before it is missed
+			running = service.isRunning();
+			while (service.poll(result))
+			{
+				games++;
+				frames += result.steps;
+				shots += result.shots;
+				pocketed += result.pocketed;
+				scratches += result.scratches;
+				cleared += result.pocketed == NUM_OF_BALLS - 1;
+			}
+			if (running)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		double seconds = (monotonicNanoseconds() - start) * 1e-9;
+		if (threads == 1)
+		{
+			single = seconds;
+			printf("per game: %.1f shots, %.1f pocketed, %.1f scratches, "
+				"%.1f%% cleared, %.0f frames\n", (double) shots / games,
+				(double) pocketed / games, (double) scratches / games,
+				100.0 * cleared / games, (double) frames / games);
+		}
+
+		printf("%8d %10.3f %10d %14.0f %10.2f\n", threads, seconds, games,
+			frames / seconds, single / seconds);
+
+		if (threads == maxThreads)
+		{
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <math.h>
+#include "BallMotion.h"
+
+// the slip shrinks this many times faster than the velocity slows down
+const float slip_decay = 3.5f;
+
+// and the spin picks up this many times as fast
+const float spin_gain = 2.5f;
+
+MotionPhase motionPhase(float vx, float vy, float wx, float wy)
+{
+	if (vx != wx || vy != wy)
+	{
+		return PHASE_SLIDING;
+	}
+
+	return vx != 0.0f || vy != 0.0f ? PHASE_ROLLING : PHASE_RESTING;
+}
+
+/*
+* The time until a ball with the given velocity and spin stops, or HUGE_VAL
+* if it slides on a cloth without friction.
+*/
+float restTime(float vx, float vy, float wx, float wy, float friction)
+{
+	float ux = vx - wx;
+	float uy = vy - wy;
+	float slip = sqrtf(ux * ux + uy * uy);
+	float time = 0.0f;
+
+	if (slip > 0.0f)
+	{
+		if (friction <= 0.0f)
+		{
+			return HUGE_VAL;
+		}
+
+		// the velocity it rolls on at, see BallMotion.h
+		time = slip / (slip_decay * friction * gravity);
+		vx = (5 * vx + 2 * wx) / 7;
+		vy = (5 * vy + 2 * wy) / 7;
+	}
+
+	return time + sqrtf(vx * vx + vy * vy) / (rolling_friction * gravity);
+}
+
+/*
+* Move a ball at (x, y) forward by time seconds of sliding, rolling and
+* resting on an open cloth, updating its velocity and spin.
+*/
+void moveBall(float &x, float &y, float &vx, float &vy, float &wx, float &wy,
+			float friction, float time)
+{
+	float ux = vx - wx;
+	float uy = vy - wy;
+	float slip = sqrtf(ux * ux + uy * uy);
+
+	if (slip > 0.0f)
+	{
+		float slide = friction * gravity;
+		if (slide <= 0.0f)
+		{
+			x += time * vx;
+			y += time * vy;
+			return;
+		}
+
+		float slideTime = slip / (slip_decay * slide);
+		float t = time < slideTime ? time : slideTime;
+		float dx = ux / slip;
+		float dy = uy / slip;
+
+		x += t * vx - 0.5f * slide * t * t * dx;
+		y += t * vy - 0.5f * slide * t * t * dy;
+
+		if (t < slideTime)
+		{
+			vx -= slide * t * dx;
+			vy -= slide * t * dy;
+			wx += spin_gain * slide * t * dx;
+			wy += spin_gain * slide * t * dy;
+			return;
+		}
+
+		// rolling from here on
+		vx = wx = (5 * vx + 2 * wx) / 7;
+		vy = wy = (5 * vy + 2 * wy) / 7;
+		time -= t;
+	}
+
+	float speed = sqrtf(vx * vx + vy * vy);
+	float roll = rolling_friction * gravity;
+	float stopTime = speed / roll;
+
+	if (time >= stopTime)
+	{
+		x += 0.5f * stopTime * vx;
+		y += 0.5f * stopTime * vy;
+		vx = vy = wx = wy = 0.0f;
+		return;
+	}
+
+	// the distance covered is (speed - roll * time / 2) * time
+	float travel = time - 0.5f * roll * time * time / speed;
+	float slowdown = 1.0f - roll * time / speed;
+	x += travel * vx;
+	y += travel * vy;
+	vx = wx = slowdown * vx;
+	vy = wy = slowdown * vy;
+}
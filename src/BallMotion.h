@@ -0,0 +1,40 @@
+/*
+* Closed-form motion of a ball on the cloth: it slides, rolls and stops.
+*
+* Besides its velocity v a ball carries w, the velocity its spin alone would
+* roll it at; w equals v while it rolls. As long as they differ the ball
+* slides: the cloth rubs against the slip u = v - w with the friction of the
+* ball's material, which slows v down by friction * gravity and pulls w
+* along by 5/2 of that, both in the direction of u. The slip keeps its
+* direction and shrinks at 7/2 friction * gravity, so after
+* |u| / (7/2 friction * gravity) the ball rolls, at (5 v + 2 w) / 7. Rolling,
+* it slows down by rolling_friction * gravity until it rests.
+*
+* Every phase is a constant deceleration in a fixed direction, so the state
+* at any time is a handful of multiplications away, however long that time
+* is: moveBall() jumps there directly and restTime() says when the ball
+* stops. A ball struck in its center starts sliding without spin and rolls
+* on at 5/7 of its speed.
+*/
+
+#ifndef BALL_MOTION_H
+#define BALL_MOTION_H
+
+const float gravity = 9.81f;
+
+// of a rolling ball on the cloth, whatever the ball is made of
+const float rolling_friction = 0.01f;
+
+enum MotionPhase
+{
+	PHASE_SLIDING,
+	PHASE_ROLLING,
+	PHASE_RESTING
+};
+
+MotionPhase motionPhase(float vx, float vy, float wx, float wy);
+float restTime(float vx, float vy, float wx, float wy, float friction);
+void moveBall(float &x, float &y, float &vx, float &vy, float &wx, float &wy,
+			float friction, float time);
+
+#endif
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include "BallSystem.h"
+
+BallSystem::BallSystem()
+	: x(0), y(0), lastX(0), lastY(0), vx(0), vy(0), wx(0), wy(0), radius(0),
+	id(0), active(0), material(0), numOfMaterials(0), count(0), capacity(0),
+	block(0), memory(0)
+{
+}
+
+BallSystem::BallSystem(const BallSystem &other)
+	: x(0), y(0), lastX(0), lastY(0), vx(0), vy(0), wx(0), wy(0), radius(0),
+	id(0), active(0), material(0), numOfMaterials(0), count(0), capacity(0),
+	block(0), memory(0)
+{
+	copyFrom(other);
+}
+
+BallSystem &BallSystem::operator=(const BallSystem &rhs)
+{
+	if (this != &rhs)
+	{
+		copyFrom(rhs);
+	}
+
+	return *this;
+}
+
+BallSystem::~BallSystem()
+{
+	release();
+}
+
+/*
+* Size in bytes of one array for the given capacity, rounded up so that the
+* next array starts aligned.
+*/
+static size_t arrayBytes(int capacity, size_t elementSize)
+{
+	size_t bytes = capacity * elementSize;
+	return (bytes + ball_align - 1) / ball_align * ball_align;
+}
+
+static size_t blockBytes(int capacity)
+{
+	return 9 * arrayBytes(capacity, sizeof(float)) +
+		arrayBytes(capacity, sizeof(int)) +
+		2 * arrayBytes(capacity, sizeof(unsigned char));
+}
+
+/*
+* Allocate the arrays for count balls. The previous contents are lost; every
+* entry starts as an inactive padding entry. The block is kept if it already
+* has the right size, so setting up the same number of balls again does not
+* allocate.
+*/
+void BallSystem::allocate(int n)
+{
+	int padded = (n + ball_lanes - 1) / ball_lanes * ball_lanes;
+	if (padded != capacity || !block)
+	{
+		release();
+		capacity = padded;
+		if (capacity == 0)
+		{
+			count = n;
+			return;
+		}
+
+		memory = (char *) malloc(blockBytes(capacity) + ball_align);
+		block = (char *) (((uintptr_t) memory + ball_align - 1) /
+			ball_align * ball_align);
+	}
+
+	count = n;
+	size_t bytes = blockBytes(capacity);
+
+	char *p = block;
+	x = (float *) p;		p += arrayBytes(capacity, sizeof(float));
+	y = (float *) p;		p += arrayBytes(capacity, sizeof(float));
+	lastX = (float *) p;	p += arrayBytes(capacity, sizeof(float));
+	lastY = (float *) p;	p += arrayBytes(capacity, sizeof(float));
+	vx = (float *) p;		p += arrayBytes(capacity, sizeof(float));
+	vy = (float *) p;		p += arrayBytes(capacity, sizeof(float));
+	wx = (float *) p;		p += arrayBytes(capacity, sizeof(float));
+	wy = (float *) p;		p += arrayBytes(capacity, sizeof(float));
+	radius = (float *) p;	p += arrayBytes(capacity, sizeof(float));
+	id = (int *) p;			p += arrayBytes(capacity, sizeof(int));
+	active = (unsigned char *) p;	p += arrayBytes(capacity, 1);
+	material = (unsigned char *) p;
+
+	memset(block, 0, bytes);
+	for (int i = 0; i < capacity; i++)
+	{
+		x[i] = lastX[i] = far_away;
+		y[i] = lastY[i] = far_away;
+		id[i] = -1;
+	}
+}
+
+void BallSystem::release()
+{
+	free(memory);
+	memory = 0;
+	block = 0;
+	x = y = lastX = lastY = vx = vy = wx = wy = radius = 0;
+	id = 0;
+	active = material = 0;
+	count = capacity = 0;
+}
+
+void BallSystem::copyFrom(const BallSystem &other)
+{
+	if (capacity != other.capacity)
+	{
+		allocate(other.count);
+	}
+
+	count = other.count;
+	if (capacity > 0)
+	{
+		memcpy(block, other.block, blockBytes(capacity));
+	}
+
+	memcpy(materials, other.materials, sizeof(materials));
+	numOfMaterials = other.numOfMaterials;
+}
+
+/*
+* Set the number of balls. All balls are reset to inactive padding entries
+* and the material table is cleared.
+*/
+void BallSystem::resize(int n)
+{
+	allocate(n);
+	numOfMaterials = 0;
+}
+
+int BallSystem::size() const
+{
+	return count;
+}
+
+int BallSystem::paddedSize() const
+{
+	return capacity;
+}
+
+/*
+* Permute the balls so that ball i moves to where ball order[i] was. scratch
+* is used as the destination and afterwards holds the old arrays, so passing
+* the same scratch every time avoids any allocation. The material table is
+* not touched.
+*/
+void BallSystem::reorder(const int *order, BallSystem &scratch)
+{
+	if (scratch.capacity != capacity)
+	{
+		scratch.allocate(count);
+	}
+	scratch.count = count;
+
+	for (int i = 0; i < count; i++)
+	{
+		int from = order[i];
+		scratch.x[i] = x[from];
+		scratch.y[i] = y[from];
+		scratch.lastX[i] = lastX[from];
+		scratch.lastY[i] = lastY[from];
+		scratch.vx[i] = vx[from];
+		scratch.vy[i] = vy[from];
+		scratch.wx[i] = wx[from];
+		scratch.wy[i] = wy[from];
+		scratch.radius[i] = radius[from];
+		scratch.id[i] = id[from];
+		scratch.active[i] = active[from];
+		scratch.material[i] = material[from];
+	}
+
+	std::swap(x, scratch.x);
+	std::swap(y, scratch.y);
+	std::swap(lastX, scratch.lastX);
+	std::swap(lastY, scratch.lastY);
+	std::swap(vx, scratch.vx);
+	std::swap(vy, scratch.vy);
+	std::swap(wx, scratch.wx);
+	std::swap(wy, scratch.wy);
+	std::swap(radius, scratch.radius);
+	std::swap(id, scratch.id);
+	std::swap(active, scratch.active);
+	std::swap(material, scratch.material);
+	std::swap(block, scratch.block);
+	std::swap(memory, scratch.memory);
+}
+
+/*
+* Add an entry to the material table and return its index. When the table is
+* full the last material is returned instead.
+*/
+int BallSystem::addMaterial(float friction, float bounciness)
+{
+	if (numOfMaterials == MAX_MATERIALS)
+	{
+		return MAX_MATERIALS - 1;
+	}
+
+	materials[numOfMaterials].friction = friction;
+	materials[numOfMaterials].bounciness = bounciness;
+	return numOfMaterials++;
+}
+
+const Material &BallSystem::materialOf(int i) const
+{
+	return materials[material[i]];
+}
@@ -0,0 +1,78 @@
+/*
+* Structure-of-arrays storage for the balls of a World.
+*
+* Every property of the balls is kept in its own contiguous array, so a loop
+* over one property (e.g. integrating x with vx) streams through memory
+* instead of jumping between separately allocated objects. All arrays live in
+* a single block; each one starts on a ball_align byte boundary and is padded
+* to a multiple of ball_lanes entries so it can be processed in full SIMD
+* registers. Padding entries are inactive, have a zero radius and sit far away
+* from the table.
+*
+* Properties shared by many balls (friction, bounciness) are kept once in a
+* side table of materials and referenced by index. The spin (wx, wy) is only
+* used by MOTION_SLIDE_ROLL, see BallMotion.h.
+*/
+
+#ifndef BALL_SYSTEM_H
+#define BALL_SYSTEM_H
+
+#define MAX_MATERIALS 8
+
+const int ball_align = 64;
+const int ball_lanes = 16;
+
+// position of the padding entries, far away from any table
+const float far_away = 1.0e6f;
+
+struct Material
+{
+	float friction;
+	float bounciness;
+};
+
+class BallSystem
+{
+	public:
+		BallSystem();
+		BallSystem(const BallSystem &other);
+		BallSystem &operator=(const BallSystem &rhs);
+		~BallSystem();
+
+		void resize(int count);
+		int size() const;
+		int paddedSize() const;
+
+		void reorder(const int *order, BallSystem &scratch);
+
+		int addMaterial(float friction, float bounciness);
+		const Material &materialOf(int i) const;
+
+		float *x;
+		float *y;
+		float *lastX; // position at the start of the last step
+		float *lastY;
+		float *vx;
+		float *vy;
+		float *wx; // velocity the spin alone would roll the ball at
+		float *wy;
+		float *radius;
+		int *id;
+		unsigned char *active;
+		unsigned char *material;
+
+		Material materials[MAX_MATERIALS];
+		int numOfMaterials;
+
+	private:
+		void allocate(int count);
+		void release();
+		void copyFrom(const BallSystem &other);
+
+		int count;
+		int capacity;
+		char *block;
+		char *memory;
+};
+
+#endif
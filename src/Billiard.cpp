@@ -2,11 +2,13 @@
 #include <stdlib.h>
 #include <math.h>
 #include "Billiard.h"
-#include "Vector.h"
-#include <time.h>
-
-#define NUM_OF_BALLS 16
-#define NUM_OF_POCKETS 6
+#include "CircleRenderer.h"
+#include "StaticLayer.h"
+#include "OffscreenContext.h"
+#include "FrameExporter.h"
+#include "FrameScheduler.h"
+#include "Stats.h"
+#include "Trace.h"
 
 const float converted_table_length = window_width - 2 * border;
 const float converted_table_width = window_height - 2 * border;
@@ -14,12 +16,6 @@ const float meter_to_coord = converted_table_length/table_length;
 const float converted_ball_radius = ball_radius * meter_to_coord;
 const float converted_pocket_radius = pocket_radius * meter_to_coord;
 
-const float MAX_FORCE = 200.0f; //TODO: tweak
-
-const float frame_time = 1.0f / fps;
-
-const float degree_to_radian = 3.14159265f/180.f;
-
 GLfloat white[] = {1, 1, 1, 1};
 GLfloat green[] = {0, 1, 0, 1};
 GLfloat red[] = {1, 0, 0, 1};
@@ -28,249 +24,260 @@ GLfloat yellow[] = {1, 1, 0, 1};
 GLfloat pink[] = {1, 0, 1, 1};
 GLfloat lightBlue[] = {0, 1, 1, 1};
 
-float cueBallPower = 0.0f;
-int cueBallAngle = 90;
+// the game runs on a thread of its own, this file draws the frames it
+// publishes and sends it the input
+SimulationThread simulation;
+CircleRenderer circles;
+StaticLayer staticLayer;
 
-Table *table;
-Ball *balls[NUM_OF_BALLS];
-Ball *pockets[NUM_OF_POCKETS];
-bool ballVisible[NUM_OF_BALLS];
+// whether a replay is playing instead of the game
+bool replaying = false;
 
-time_t startTime;
-float accumulator = 0.0f;
-//float alpha = 0.0f;
+// the aim of the cue as last printed
+int shownAngle = 90;
+float shownPower = 0.0f;
+
+// how far ',' and '.' jump in a replay
+const float replay_jump_seconds = 10.0f;
+
+const char *trace_path = "billiard_trace.json";
+
+#ifdef BILLIARD_STATS
+FrameStats frameStats;
+TableFrame counted; // the totals of the frame last recorded
+bool showHud = false;
+const char *stats_csv_path = "billiard_stats.csv";
+#endif
 
 /*****************************************************************************
 							Helper Functions
 ******************************************************************************/
 
 /*
-* Initialize the table object
+* Draw a green table.
 */
-void setupTable(float length)
+void drawTable()
 {
-	table = new Table(length);
+	TRACE_ZONE("drawTable");
+
+	glPushMatrix();
+	{
+		glTranslatef(border, border, 0);
+		glColor3f(0, 1, 1);
+		glRectf(0, 0, converted_table_length, converted_table_width);
+	}
+	glPopMatrix();
 }
 
 /*
-* Initialize the balls and set their locations
+* Queue the balls of frame for drawing, alpha of the way between their last
+* two physics positions.
 */
-void setupBalls(float radius, int numOfBalls)
+void drawBalls(const TableFrame &frame, float alpha)
 {
-	/* The balls are set up as follows
-						0
-
-
-
+	TRACE_ZONE("drawBalls");
 
+	for (size_t i = 0; i < frame.x.size(); i++)
+	{
+		//TODO: draw the balls with different colors
+		float x = frame.lastX[i] + (frame.x[i] - frame.lastX[i]) * alpha;
+		float y = frame.lastY[i] + (frame.y[i] - frame.lastY[i]) * alpha;
 
-						1
-					2		3
-				4		5		6
-			7		8		9		10
-		11 		12 		13 		14 		15
+		circles.add(border + x * meter_to_coord, border + y * meter_to_coord,
+			converted_ball_radius, frame.id[i] == 0 ? white : red);
+	}
+}
 
-	Note that the the radius of any three touching ball forms an
-	equalaterial triangle. The distance between each row is root_three * r.
-	The distance between each column is 2*r. A little extra room (0.0001) is
-	added inbetween all of the balls. */
+/*
+* Queue the pockets for drawing.
+*/
+void drawPockets(const TableFrame &frame)
+{
+	TRACE_ZONE("drawPockets");
 
-	for (int i = 0; i < numOfBalls; i++)
+	for (size_t i = 0; i < frame.pockets.size(); i++)
 	{
-		balls[i] = new Ball(radius, i);
-		ballVisible[i] = true;
+		const Pocket &pocket = frame.pockets[i];
+		circles.add(border + pocket.x * meter_to_coord,
+			border + pocket.y * meter_to_coord, converted_pocket_radius, yellow);
 	}
+}
 
-	// add some extra room so the balls are not touching
-	radius += 0.0005f;
-
-	const float root_three = sqrt(3);
-
-	float x = table->length/4;
-	float y = table->length/4;
-	balls[0]->position.set(x, y, 0.0f); // cue ball
-
-	x = x * 3;
-	int counter = 0;
-	for (int i = 1; i < numOfBalls; i++)
-	{
-		if (i == 2 || i == 4 || i == 7 || i == 11)
-		{
-			x = x + root_three * radius;
-			y = y - radius;
-			counter = 0;
-		}
+/*
+* Release the cue ball with the angle and power aimed at.
+*/
+void powerKey()
+{
+	simulation.send(SimulationCommand(COMMAND_SHOOT));
+}
 
-		balls[i]->position.set(x, y + 2 * counter * radius, 0.0f);
-		counter++;
-	}
+/*
+* Search for a good shot for half a second and aim the cue there.
+*/
+void findShotKey()
+{
+	simulation.send(SimulationCommand(COMMAND_FIND_SHOT));
 }
 
+#ifdef BILLIARD_STATS
 /*
-* Initialize the pockets and set their locations
+* Close the frame just drawn: store the physics time and the counters of
+* the steps since the frame recorded last, and the render time.
 */
-void setupPockets(float radius, int numOfPockets)
+void recordFrame(const TableFrame &frame, long long renderTime)
 {
-	/* The pockets are set up as following
-		P0------------------P1------------------P2
-		|										|
-		|										|
-		|										|
-		|										|
-		|										|
-		P3------------------P4------------------P5
+	FrameRecord record;
+	record.physicsTime = frame.physicsTime - counted.physicsTime;
+	record.renderTime = renderTime;
+	record.counters.pairTests =
+		frame.counters.pairTests - counted.counters.pairTests;
+	record.counters.collisions =
+		frame.counters.collisions - counted.counters.collisions;
+	record.counters.cushionHits =
+		frame.counters.cushionHits - counted.counters.cushionHits;
+	record.counters.pocketed =
+		frame.counters.pocketed - counted.counters.pocketed;
+	record.counters.substeps =
+		frame.counters.substeps - counted.counters.substeps;
+	frameStats.add(record);
+
+	counted.physicsTime = frame.physicsTime;
+	counted.counters = frame.counters;
+}
 
-		There are 4 corner pockets and 2 side pockets.
-	*/
+/*
+* Print the rolling frame times and the counters of the last frame in the
+* top left corner of the table.
+*/
+void drawHud()
+{
+	TRACE_ZONE("drawHud");
 
-	for (int i = 0; i < numOfPockets; i++)
+	if (!showHud || frameStats.numOfFrames() == 0)
 	{
-		pockets[i] = new Ball(radius, i);
+		return;
 	}
 
-	float x = 0.0f;
-	float y = 0.0f;
-
-	for (int i = 0; i < numOfPockets; i++)
+	const FrameRecord &last = frameStats.last();
+	char lines[4][128];
+	snprintf(lines[0], sizeof(lines[0]),
+		"physics ms  p50 %.3f  p95 %.3f  p99 %.3f",
+		frameStats.percentile(SERIES_PHYSICS_TIME, 50) * 1e-6,
+		frameStats.percentile(SERIES_PHYSICS_TIME, 95) * 1e-6,
+		frameStats.percentile(SERIES_PHYSICS_TIME, 99) * 1e-6);
+	snprintf(lines[1], sizeof(lines[1]),
+		"render ms   p50 %.3f  p95 %.3f  p99 %.3f",
+		frameStats.percentile(SERIES_RENDER_TIME, 50) * 1e-6,
+		frameStats.percentile(SERIES_RENDER_TIME, 95) * 1e-6,
+		frameStats.percentile(SERIES_RENDER_TIME, 99) * 1e-6);
+	snprintf(lines[2], sizeof(lines[2]),
+		"pair tests %lld  collisions %lld  cushions %lld  pockets %lld  "
+		"substeps %lld", last.counters.pairTests, last.counters.collisions,
+		last.counters.cushionHits, last.counters.pocketed,
+		last.counters.substeps);
+	snprintf(lines[3], sizeof(lines[3]), "%s%s",
+		frameStats.isWritingCsv() ? "writing " : "",
+		frameStats.isWritingCsv() ? stats_csv_path : "");
+
+	glColor3f(0, 0, 0);
+	for (int i = 0; i < 4; i++)
 	{
-		if (i == 3)
+		glRasterPos2f(border + 8, border + 18 + 15 * i);
+		for (const char *c = lines[i]; *c; c++)
 		{
-			x = 0.0f;
-			y = table->width;
+			glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
 		}
-
-		pockets[i]->position.set(x, y, 0.0f);
-		x = x + table->width;
 	}
-
-	//DEBUG: printing out the locations of the pockets
-	// for (int i = 0; i < numOfPockets; i++)
-	// {
-	// 	printf("Pocket %d ", i);
-	// 	pockets[i]->position.print();
-	// }
 }
 
 /*
-* Helper function used to draw the balls in 2d
+* The keys of the statistics, taken in a replay as well. Returns whether
+* the key was one of them.
+*	h: show or hide the HUD
+*	c: start or stop writing every frame to billiard_stats.csv
 */
-void drawCircle(float radius)
+bool statsKey(unsigned char key)
 {
-   glBegin(GL_LINE_LOOP);
-
-   for (int i=0; i<360; i++)
-   {
-      float degInRad = i*degree_to_radian;
-      glVertex2f(cos(degInRad)*radius, sin(degInRad)*radius);
-   }
+	switch(key)
+	{
+		case 104: // h key
+			showHud = !showHud;
+			glutPostRedisplay();
+			return true;
+		case 99: // c key
+			if (frameStats.isWritingCsv())
+				frameStats.stopCsv();
+			else if (!frameStats.startCsv(stats_csv_path))
+				printf("cannot write %s\n", stats_csv_path);
+			return true;
+	}
 
-   glEnd();
+	return false;
 }
+#endif
 
 /*
-* Draw a green table.
+* Stop tracing and write the timeline, if tracing. Also runs at exit.
 */
-void drawTable()
+void saveTrace()
 {
-	glPushMatrix();
-	{
-		glTranslatef(border, border, 0);
-		glColor3f(0, 1, 1);
-		glRectf(0, 0, converted_table_length, converted_table_width);
-	}
-	glPopMatrix();
+	if (!isTracing())
+		return;
+
+	stopTracing();
+	if (writeTrace(trace_path))
+		printf("trace written to %s\n", trace_path);
+	else
+		printf("cannot write %s\n", trace_path);
 }
 
 /*
-* Draw the balls by looping through the global **balls.
+* Start tracing, or stop and write the trace.
 */
-void drawBalls()
+void traceKey()
 {
-	for (int i = 0; i < NUM_OF_BALLS; i++)
-	{
-		if (!ballVisible[i])
-		{
-			continue;
-		}
-
-		//TODO: draw the balls with different colors
-		glPushMatrix();
-		{
-			glTranslatef(border + balls[i]->position.x * meter_to_coord,
-						border + balls[i]->position.y * meter_to_coord, 0.0f);
-
-			if (i == 0)
-				glColor4fv(white);
-			else
-				glColor4fv(red);
-
-			drawCircle(converted_ball_radius);
-		}
-		glPopMatrix();
-	}
+	if (isTracing())
+		saveTrace();
+	else
+		startTrace();
 }
 
 /*
-* Draw the pockets.
+* Reset the game and place the balls into their original location
 */
-void drawPockets()
+void resetGame()
 {
-	for (int i = 0; i < NUM_OF_POCKETS; i++)
-	{
-		glPushMatrix();
-		{
-			glTranslatef(border + pockets[i]->position.x * meter_to_coord,
-						border + pockets[i]->position.y * meter_to_coord, 0.0f);
-
-			glColor4fv(yellow);
+	simulation.send(SimulationCommand(COMMAND_RESET));
+	staticLayer.invalidate();
+}
 
-			drawCircle(converted_pocket_radius);
-		}
-		glPopMatrix();
-	}
+/*
+* Put the table back to how it was before the last shot. Not available while
+* recording, since the replay could not follow.
+*/
+void undoKey()
+{
+	simulation.send(SimulationCommand(COMMAND_UNDO));
 }
 
 /*
-* Convert the angle and power into vectors and add to the cue ball.
+* Switch to the next engine, in the order fixed step, adaptive step, event
+* driven.
 */
-void powerKey()
+void engineKey()
 {
-	if (cueBallPower > 0.0)
-	{
-		/* Assume angle starts at the top of the y-axis
-		and goes clockwise around the quadrant.The angles
-		are decomposed into a pair of unit vectors that
-		points to the direction and are assigned to the
-		cue ball.*/
-
-		//DEBUG: max power
-		//cueBallPower = 1.0;
-
-		float speed = cueBallPower * MAX_FORCE / meter_to_coord;
-		balls[0]->velocity.set(sin(cueBallAngle * degree_to_radian) * speed,
-							cos(cueBallAngle * degree_to_radian) * speed,
-							0.0f);
-
-		cueBallPower = 0; // reset the power
-		startTime = time(NULL);
-
-		//DEBUG: Printing out parameters of the cue ball
-		printf("Cueball Velocity: x: %f y: %f z: %f\n",
-								balls[0]->velocity.x,
-								balls[0]->velocity.y,
-								balls[0]->velocity.z);
-		//printf("Start time: %ld\n", startTime);
-		update();
-		//glutPostRedisplay();
-	}
+	simulation.send(SimulationCommand(COMMAND_NEXT_ENGINE));
 }
 
 /*
-* Reset the game and place the balls into their original location
+* Turn the cue by angle degrees and add power to the shot.
 */
-void resetGame()
+void aimKey(int angle, float power)
 {
-	setupGame();
+	SimulationCommand command(COMMAND_AIM);
+	command.angle = angle;
+	command.power = power;
+	simulation.send(command);
 }
 
 /*
@@ -293,207 +300,172 @@ void setupRenderingContext()
 	glClearColor(0.0, 0.0, 0.0, 0.0);
 
 	//initLights();
-}
 
-float collisionPoint(Ball *ball1, Ball *ball2, float frameTime,
-							float distanceAtFrameEnd, float collisionDistance)
-{
-	Vector ball1FrameStartPosition = ball1->position - (frameTime * ball1->velocity);
-	Vector ball2FrameStartPosition = ball2->position - (frameTime * ball2->velocity);
-
-	float distanceAtFrameStart = (ball2FrameStartPosition  - ball1FrameStartPosition ).length();
-
-	float collisionTime = frameTime * (distanceAtFrameStart - collisionDistance ) / (distanceAtFrameStart - distanceAtFrameEnd) ;
+	setTraceThreadName("main");
+	atexit(saveTrace);
+
+	GLenum error = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// an offscreen context has no GLX display, the GL functions are loaded
+	// all the same
+	if (error == GLEW_ERROR_NO_GLX_DISPLAY)
+		error = GLEW_OK;
+#endif
+	if (error != GLEW_OK)
+	{
+		printf("glewInit: %s\n", glewGetErrorString(error));
+	}
+	if (!circles.init())
+	{
+		printf("instanced drawing not supported, using immediate mode\n");
+	}
+	if (!staticLayer.init(window_width, window_height))
+	{
+		printf("framebuffer objects not supported, redrawing the table every frame\n");
+	}
+}
 
-	ball1->position = ball1FrameStartPosition + (collisionTime * ball1->velocity);
-	ball2->position = ball2FrameStartPosition + (collisionTime * ball2->velocity);
+/*****************************************************************************
+							Public Functions
+******************************************************************************/
 
-	return (frameTime - collisionTime);
+/*
+* Set up the game components.
+*/
+void setupGame()
+{
+	simulation.setup();
 }
 
-void collide(Ball *ball1, Ball *ball2, float frameTime)
+/*
+* Record the game from now on into the file at path.
+*/
+bool startRecording(const char *path)
 {
-	Vector normalPlane = ball2->position - ball1->position;
-	float distanceAtFrameEnd = normalPlane.length();
-
-	float collisionDistance = ball1->radius + ball2->radius;
-
-	if (distanceAtFrameEnd <= collisionDistance)
-	{
-		float collisionTime = collisionPoint(ball1, ball2, frameTime,
-			distanceAtFrameEnd, collisionDistance);
-
-		normalPlane.normalize();
+	return simulation.startRecording(path);
+}
 
-		Vector collisionPlane(-normalPlane.y, normalPlane.x, 0);
+/*
+* Record a timeline of the frames until the t key is pressed again or the
+* game is left, then write it to billiard_trace.json.
+*/
+void startTrace()
+{
+	startTracing();
+	printf("tracing, press t to write %s\n", trace_path);
+}
 
-		float n_vel2 = Vector::dot(normalPlane, ball1->velocity);
-		float c_vel1 = Vector::dot(collisionPlane, ball1->velocity);
-		float n_vel1 = Vector::dot(normalPlane, ball2->velocity);
-		float c_vel2 = Vector::dot(collisionPlane, ball2->velocity);
+/*
+* Play the game recorded in the file at path instead of taking input.
+*/
+bool startReplay(const char *path)
+{
+	replaying = simulation.startReplay(path);
+	return replaying;
+}
 
-		Vector vel1 = (n_vel1 * normalPlane) + (c_vel1 * collisionPlane);
-		Vector vel2 = (n_vel2 * normalPlane) + (c_vel2 * collisionPlane);
+/*
+* Stop the simulation thread, before anything it uses is torn down.
+*/
+void stopSimulation()
+{
+	simulation.stop();
+}
 
-		ball1->position = ball1->position + (collisionTime * vel1);
-		ball2->position = ball2->position + (collisionTime * vel2);
+/*
+* Start running the game set up so far on its own thread. Called once the
+* recording or replay is chosen, before entering the main loop.
+*/
+void startSimulation()
+{
+	simulation.start();
 
-		ball1->velocity = vel1;
-		ball2->velocity = vel2;
-	}
+	// registered after every static object was built, so it runs before
+	// any of them is destroyed
+	atexit(stopSimulation);
 }
 
-bool collideWithPockets(Ball *ball)
+/*
+* Jump the replay by the given number of seconds.
+*/
+void seekReplay(float seconds)
 {
-	float x = ball->position.x;
-	float y = ball->position.y;
-	float radius = ball->radius;
-	int id = ball->id;
+	SimulationCommand command(COMMAND_SEEK);
+	command.seconds = seconds;
+	simulation.send(command);
+}
 
-	// P0------------------P1------------------P2
-	// |										|
-	// |										|
-	// |										|
-	// |										|
-	// |										|
-	// P3------------------P4------------------P5
+/*
+* Render the replay in the file at path without a window and write it as
+* raw RGB video of window_width x window_height pixels to outPath, or to
+* standard output if outPath is "-". The video has render_fps frames per
+* second of game time, with the balls in between physics steps interpolated
+* as on screen. Does not need GLUT or a display.
+*/
+bool exportReplay(const char *path, const char *outPath)
+{
+	OffscreenContext context;
+	FrameExporter exporter;
 
-	// check for collision with left side of table
-	if (x - radius < 0)
+	// opened first, so that nothing printed from here on goes into the video
+	if (!exporter.open(outPath, window_width, window_height))
 	{
-		ball->velocity.x = -1 * ball->velocity.x;
-
-		if (id != 0)
-		{
-			// check for collision with the pockets on the left (0 and 3)
-			if (y < (pockets[0]->position.y + pockets[0]->radius) ||
-				y > pockets[3]->position.y - pockets[3]->radius)
-			{
-				ballVisible[id] = false;
-				return true;
-			}
-		}
+		printf("cannot write to %s\n", outPath);
+		return false;
 	}
 
-	// check for collision with rightside of table
-	if (x + radius > table->length)
-	{
-		ball->velocity.x = -1 * ball->velocity.x;
+	if (!context.create(window_width, window_height))
+		return false;
 
-		if (id != 0)
-		{
-			// check for collision with the pockets on the left (2 and 5)
-			if (y < (pockets[2]->position.y + pockets[2]->radius) ||
-				y > pockets[5]->position.y - pockets[5]->radius)
-			{
-				ballVisible[id] = false;
-				return true;
-			}
-		}
-	}
+	glViewport(0, 0, window_width, window_height);
+	setupRenderingContext();
 
-	// check for collision with top of table
-	if (y - radius < 0)
+	// played here rather than on the simulation thread, which keeps real
+	// time
+	World world;
+	ReplayReader replay;
+	if (!replay.open(path) || !replay.seek(world, 0))
 	{
-		ball->velocity.y = -1 * ball->velocity.y;
-
-		if (id != 0)
-		{
-			// check for collision with the pockets on the top (0, 1, and 2)
-			if (x < (pockets[0]->position.x + pockets[0]->radius) ||
-				x > pockets[2]->position.x - pockets[2]->radius  ||
-				(x > pockets[1]->position.x - pockets[1]->radius &&
-				x < pockets[1]->position.x + pockets[1]->radius )
-				)
-			{
-				ballVisible[id] = false;
-				return true;
-			}
-		}
+		printf("cannot replay %s\n", path);
+		return false;
 	}
+	printf("replaying %d frames\n", replay.numOfFrames());
 
-	// check for collision with bottom of table
-	if (y + radius > table->width)
-	{
-		ball->velocity.y = -1 * ball->velocity.y;
+	TableFrame frame;
+	int replayFrame = 0;
 
-		if (id != 0)
-		{
-			// check for collision with the pockets on the top (3, 4, and 5)
-			if (x < (pockets[3]->position.x + pockets[3]->radius) ||
-				x > pockets[5]->position.x - pockets[5]->radius  ||
-				(x > pockets[4]->position.x - pockets[4]->radius &&
-				x < pockets[4]->position.x + pockets[4]->radius )
-				)
-			{
-				ballVisible[id] = false;
-				return true;
-			}
-		}
-	}
+	// game time instead of real time, so that every frame is rendered no
+	// matter how long it takes
+	FrameScheduler clock(replay.stepTime());
+	const long long frame_length = 1000000000LL / render_fps;
+	long long now = 0;
+	clock.frame(now);
 
-	return false;
-}
-
-/*
-* Perform collision detecton and collision resolution for all the balls
-* and also update their speed
-*/
-void updatePhysics(float timePassed)
-{
-	//printf("updatePhysics is called!\n");
-	for (int i = 0; i < NUM_OF_BALLS; i++)
+	long long start = monotonicNanoseconds();
+	while (true)
 	{
-		// only update the physics for balls that are visible
-		if (!ballVisible[i])
-		{
-			continue;
-		}
-
-		// first, update the ball's position if it's moving
-		if (balls[i]->velocity.length() > 0.0f)
-		{
-			balls[i]->position = balls[i]->position +
-											(timePassed * balls[i]->velocity);
-		}
-
-		if (collideWithPockets(balls[i]))
-		{
-			printf("collided with pocket!\n");
-			continue;
-		}
+		frame.capture(world);
+		drawScene(frame, clock.alpha());
+		if (!exporter.capture())
+			break;
 
-		// now check for collision with any other ball
-		for (int j = i + 1; j < NUM_OF_BALLS; j++)
-		{
-			collide(balls[i], balls[j], timePassed);
-		}
+		if (replayFrame >= replay.numOfFrames())
+			break;
 
-		// now update velocity
-		if (balls[i]->velocity.length() > 0.0f)
+		now += frame_length;
+		int steps = clock.frame(now);
+		for (int i = 0; i < steps && replayFrame < replay.numOfFrames(); i++)
 		{
-			balls[i]->velocity = 0.99 * balls[i]->velocity;
-			if (balls[i]->velocity.length() < 0.00001)
-			{
-				balls[i]->velocity.reset();
-			}
+			replay.step(world, replayFrame++);
 		}
 	}
-}
 
-
-/*****************************************************************************
-							Public Functions
-******************************************************************************/
-
-/*
-* Set up the game components.
-*/
-void setupGame()
-{
-	setupTable(table_length);
-	setupBalls(ball_radius, NUM_OF_BALLS);
-	setupPockets(pocket_radius, NUM_OF_POCKETS);
+	int frames = exporter.numOfFrames();
+	bool ok = exporter.close();
+	float seconds = (monotonicNanoseconds() - start) * 1e-9f;
+	printf("exported %d frames in %.2f s (%.0f frames/s)%s\n", frames, seconds,
+		frames / seconds, ok ? "" : ", writing failed");
+	return ok;
 }
 
 /*
@@ -520,11 +492,27 @@ void initLights()
 }
 
 /*
-* Draws the table and the balls
+* Draws the parts that only change on a reset: the table and the pockets.
 */
-void display()
+void drawStatic(const TableFrame &frame)
+{
+	TRACE_ZONE("drawStatic");
+
+	drawTable();
+
+	circles.clear();
+	drawPockets(frame);
+	circles.draw();
+}
+
+/*
+* Draws the table and the balls of frame into the current framebuffer. The
+* table comes from the static layer when there is one, so only the balls are
+* drawn every frame.
+*/
+void drawScene(const TableFrame &frame, float alpha)
 {
-	glClear(GL_COLOR_BUFFER_BIT);
+	TRACE_ZONE("drawScene");
 
 	// reset modelview matrix, might not be necessary
 	glMatrixMode(GL_MODELVIEW);
@@ -532,40 +520,94 @@ void display()
 
 	glPushMatrix();
 	{
-		drawTable();
-		drawPockets();
-		drawBalls();
+		if (staticLayer.needsRedraw())
+		{
+			staticLayer.beginRedraw();
+			drawStatic(frame);
+			staticLayer.endRedraw();
+		}
+
+		if (staticLayer.isSupported())
+		{
+			staticLayer.draw();
+		}
+		else
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			drawStatic(frame);
+		}
+
+		circles.clear();
+		drawBalls(frame, alpha);
+		circles.draw();
 	}
 	glPopMatrix();
+}
+
+/*
+* Draws the frame taken last from the simulation into the window, with the
+* balls where the real time puts them between its last two steps.
+*/
+void display()
+{
+	TRACE_ZONE("display");
+
+	const TableFrame &frame = simulation.frame();
+	long long start = monotonicNanoseconds();
+
+#ifdef BILLIARD_STATS
+	drawScene(frame, frame.alpha(start));
+	recordFrame(frame, monotonicNanoseconds() - start);
+
+	drawHud();
+#else
+	drawScene(frame, frame.alpha(start));
+#endif
 
 	glFlush();
 	glutSwapBuffers();
 }
 
 /*
-* Update the parameters of the balls.
+* Take the newest frame the simulation published, if any, and print the aim
+* of the cue when it changed. A new frame is only drawn if the picture
+* changed: while the balls move it is drawn every time, for the
+* interpolation, and once they have come to rest frames cost nothing until
+* the simulation publishes again.
 */
 void update()
 {
-	// time_t currentTime = time(NULL);
-	// accumulator += difftime(currentTime, startTime);
-	// startTime = currentTime;
+	TRACE_ZONE("update");
 
-	// if (accumulator > 1.f)
-	// 	accumulator = 1.f;
+	bool changed = simulation.takeFrame();
+	const TableFrame &frame = simulation.frame();
+	changed |= !frame.isStill();
 
-	// // printf("accumulator: %f\n", accumulator);
+	if (frame.cueBallAngle != shownAngle || frame.cueBallPower != shownPower)
+	{
+		shownAngle = frame.cueBallAngle;
+		shownPower = frame.cueBallPower;
+		printf("power: %.1f angle: %d\n", shownPower, shownAngle);
+	}
 
-	// while (accumulator >= frame_time)
-	// {
-	// 	updatePhysics(frame_time);
-	// 	accumulator -= frame_time;
-	// }
+#ifdef BILLIARD_STATS
+	// keep the numbers of the HUD current
+	changed |= showHud;
+#endif
 
-	//alpha = accumulator / frame_time;
+	if (changed)
+	{
+		glutPostRedisplay();
+	}
+}
 
-	updatePhysics(frame_time);
-	glutPostRedisplay();
+/*
+* Runs update() render_fps times a second.
+*/
+void timer(int value)
+{
+	update();
+	glutTimerFunc(1000 / render_fps, timer, 0);
 }
 
 /*
@@ -573,16 +615,53 @@ void update()
 */
 void reshape(int width, int height)
 {
-
+	staticLayer.resize(width, height);
+	glutPostRedisplay();
 }
 
 /*
 * Handles basic input from the Keyboard.
 *	esc: quit the game
 *	p: release the cue ball
+*	r: reset the game
+*	e: switch to the next engine: fixed step, adaptive step, event driven
+*	f: aim at the best shot a short search can find
+*	u: undo the last shot
+*	, and .: jump back and forward in a replay
+*	t: start tracing, or stop and write the trace (see startTrace())
+* A replay only takes the escape, jump and trace keys. Builds with BILLIARD_STATS
+* also take the keys of statsKey().
 */
 void keyboard(unsigned char key, int x, int y)
 {
+#ifdef BILLIARD_STATS
+	if (statsKey(key))
+		return;
+#endif
+
+	if (key == 116) // t key, in a replay as well
+	{
+		traceKey();
+		return;
+	}
+
+	if (replaying)
+	{
+		switch(key)
+		{
+			case 27: // Escape key
+				exit(0);
+				break;
+			case 44: // , key
+				seekReplay(-replay_jump_seconds);
+				break;
+			case 46: // . key
+				seekReplay(replay_jump_seconds);
+				break;
+		}
+		return;
+	}
+
 	switch(key)
 	{
 		case 27: // Escape key
@@ -594,6 +673,15 @@ void keyboard(unsigned char key, int x, int y)
 		case 114: // r key
 			resetGame();
 			break;
+		case 102: // f key
+			findShotKey();
+			break;
+		case 117: // u key
+			undoKey();
+			break;
+		case 101: // e key
+			engineKey();
+			break;
 	}
 }
 
@@ -606,32 +694,24 @@ void keyboard(unsigned char key, int x, int y)
 */
 void specialKeys(int key, int x, int y)
 {
+	if (replaying)
+		return;
+
 	switch(key)
 	{
 		case GLUT_KEY_UP:
-			cueBallPower += .1;
-			if (cueBallPower > 1.0)
-				cueBallPower = 1.f;
+			aimKey(0, .1);
 			break;
 		case GLUT_KEY_DOWN:
-			cueBallPower -= .1;
-			if (cueBallPower < 0.0)
-				cueBallPower = 0;
+			aimKey(0, -.1);
 			break;
 		case GLUT_KEY_LEFT:
-			cueBallAngle -= 20;
-			if (cueBallAngle < 0)
-				cueBallAngle += 360;
+			aimKey(-20, 0);
 			break;
 		case GLUT_KEY_RIGHT:
-			cueBallAngle += 20;
-			if (cueBallAngle > 360)
-				cueBallAngle -= 360;
+			aimKey(20, 0);
 			break;
 	}
-
-	//DEBUG: Print out cue ball power and angle
-	printf("power: %.1f angle: %d\n", cueBallPower, cueBallAngle);
 }
 
 /*
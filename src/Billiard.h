@@ -15,14 +15,17 @@
 * The weight of the balls and the coefficient of friction are not taken into
 * account. They might be incorporated in the future.
 *
+* The simulation itself lives in World (see World.h) and runs on a thread of
+* its own (see SimulationThread.h); this file only draws the frames it
+* publishes and forwards input to it.
+*
 * Author: Qian Yu
 */
 
 #ifndef BILLIARD_H
 #define BILLIARD_H
 
-#include "Ball.h"
-#include "Table.h"
+#include "SimulationThread.h"
 
 #include <GL/glew.h>
 #if defined(_WIN32)
@@ -39,17 +42,21 @@ const int border = 40;
 const int window_width = 980;
 const int window_height = (window_width / 2) + border; // 500
 
-const int fps = 25;
-
-const float table_length = 2.7f;
-const float ball_radius = 0.028575f;
-const float pocket_radius = 0.055f;
+// the physics runs at fps (see World.h), the picture is drawn up to this often
+const int render_fps = 60;
 
 void setupGame();
+bool startRecording(const char *path);
+bool startReplay(const char *path);
+void startTrace();
+void startSimulation();
+bool exportReplay(const char *path, const char *outPath);
 void initLights(void);
 void setupRenderingContext(void);
+void drawScene(const TableFrame &frame, float alpha);
 void display(void);
 void update(void);
+void timer(int value);
 void reshape(int width, int height);
 void keyboard(unsigned char key, int x, int y);
 void specialKeys(int key, int x, int y);
@@ -0,0 +1,372 @@
+#include <math.h>
+#include <algorithm>
+#include "BroadPhase.h"
+
+// Balls move a little while collisions are resolved, after the broad phase
+// has sorted them. The cells and the sweep reach are made this much larger
+// than a ball diameter so such pairs are still found.
+const float broad_phase_margin = 1.1f;
+
+BroadPhase::~BroadPhase()
+{
+}
+
+/*
+* Append [begin, end) to ranges unless it is empty. Returns the new count.
+*/
+static int addRange(IndexRange ranges[], int count, int begin, int end)
+{
+	if (begin < end)
+	{
+		ranges[count].begin = begin;
+		ranges[count].end = end;
+		count++;
+	}
+
+	return count;
+}
+
+/*
+* Append [begin, end) without ball i, which is split out of the range if it
+* lies inside.
+*/
+static int addRangeWithout(IndexRange ranges[], int count, int begin, int end,
+						int i)
+{
+	if (i < begin || i >= end)
+	{
+		return addRange(ranges, count, begin, end);
+	}
+
+	count = addRange(ranges, count, begin, i);
+	return addRange(ranges, count, i + 1, end);
+}
+
+BroadPhase *BroadPhase::create(BroadPhaseType type, const Table &table,
+								float ballRadius)
+{
+	switch (type)
+	{
+		case BROAD_PHASE_GRID:
+			return new UniformGrid(table, ballRadius);
+		case BROAD_PHASE_SWEEP_AND_PRUNE:
+			return new SweepAndPrune();
+		default:
+			return new BruteForce();
+	}
+}
+
+/*****************************************************************************
+							Brute force
+******************************************************************************/
+
+BroadPhase *BruteForce::clone() const
+{
+	return new BruteForce();
+}
+
+BroadPhaseType BruteForce::type() const
+{
+	return BROAD_PHASE_BRUTE_FORCE;
+}
+
+const char *BruteForce::name() const
+{
+	return "brute-force";
+}
+
+bool BruteForce::update(BallSystem &balls)
+{
+	return false;
+}
+
+int BruteForce::candidates(const BallSystem &balls, int i,
+							IndexRange ranges[2]) const
+{
+	ranges[0].begin = i + 1;
+	ranges[0].end = balls.size();
+	return 1;
+}
+
+int BruteForce::neighbours(const BallSystem &balls, int i,
+							IndexRange ranges[4]) const
+{
+	return addRangeWithout(ranges, 0, 0, balls.size(), i);
+}
+
+/*****************************************************************************
+							Uniform grid
+******************************************************************************/
+
+UniformGrid::UniformGrid(const Table &table, float ballRadius)
+	: length(table.length), width(table.width),
+	cellSize(2 * ballRadius * broad_phase_margin)
+{
+	columns = (int) ceil(length / cellSize);
+	rows = (int) ceil(width / cellSize);
+
+	if (columns < 1)
+		columns = 1;
+	if (rows < 1)
+		rows = 1;
+
+	cellStart.resize(columns * rows + 1);
+}
+
+BroadPhase *UniformGrid::clone() const
+{
+	Table table(length, width);
+	return new UniformGrid(table, cellSize / (2 * broad_phase_margin));
+}
+
+BroadPhaseType UniformGrid::type() const
+{
+	return BROAD_PHASE_GRID;
+}
+
+const char *UniformGrid::name() const
+{
+	return "grid";
+}
+
+/*
+* Cell index of a point. Points off the table are clamped into the border
+* cells; this never moves two points further apart in cell space, so no pair
+* is lost.
+*/
+int UniformGrid::cellOf(float x, float y) const
+{
+	int cx = (int) (x / cellSize);
+	int cy = (int) (y / cellSize);
+
+	if (cx < 0)
+		cx = 0;
+	else if (cx >= columns)
+		cx = columns - 1;
+
+	if (cy < 0)
+		cy = 0;
+	else if (cy >= rows)
+		cy = rows - 1;
+
+	return cy * columns + cx;
+}
+
+/*
+* Counting sort of the balls by cell, row by row. The sort is stable and
+* the balls hardly ever change cells between two steps, so most of the time
+* the order is already right and nothing is moved. Returns true if the balls
+* were reordered.
+*/
+bool UniformGrid::update(BallSystem &balls)
+{
+	const int n = balls.size();
+	const int cells = columns * rows;
+
+	ballCell.resize(n);
+	order.resize(n);
+	std::fill(cellStart.begin(), cellStart.end(), 0);
+
+	for (int i = 0; i < n; i++)
+	{
+		ballCell[i] = cellOf(balls.x[i], balls.y[i]);
+		cellStart[ballCell[i] + 1]++;
+	}
+
+	for (int c = 0; c < cells; c++)
+	{
+		cellStart[c + 1] += cellStart[c];
+	}
+
+	// cellStart[c] is used as the insertion point of cell c while sorting and
+	// is restored afterwards by shifting everything back by one cell
+	bool sorted = true;
+	for (int i = 0; i < n; i++)
+	{
+		int position = cellStart[ballCell[i]]++;
+		order[position] = i;
+		sorted = sorted && position == i;
+	}
+
+	for (int c = cells; c > 0; c--)
+	{
+		cellStart[c] = cellStart[c - 1];
+	}
+	cellStart[0] = 0;
+
+	if (!sorted)
+	{
+		balls.reorder(&order[0], scratch);
+
+		for (int c = 0; c < cells; c++)
+		{
+			for (int i = cellStart[c]; i < cellStart[c + 1]; i++)
+			{
+				ballCell[i] = c;
+			}
+		}
+	}
+
+	return !sorted;
+}
+
+/*
+* The candidates of a ball are the rest of its own cell and the cell to its
+* right, which are contiguous, and the three cells below it, which are
+* contiguous as well. Pairs with the cells to the left and above are found
+* from the other ball.
+*/
+int UniformGrid::candidates(const BallSystem &balls, int i,
+							IndexRange ranges[2]) const
+{
+	int cell = ballCell[i];
+	int cx = cell % columns;
+	int cy = cell / columns;
+	int right = cx + 1 < columns ? cx + 1 : cx;
+	int count = 0;
+
+	ranges[count].begin = i + 1;
+	ranges[count].end = cellStart[cy * columns + right + 1];
+	count++;
+
+	if (cy + 1 < rows)
+	{
+		int below = (cy + 1) * columns;
+		int left = cx > 0 ? cx - 1 : cx;
+
+		ranges[count].begin = cellStart[below + left];
+		ranges[count].end = cellStart[below + right + 1];
+		if (ranges[count].begin < ranges[count].end)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/*
+* The neighbours of a ball are the cells of its own row and of the rows
+* above and below it, three cells each. The three cells of a row are
+* contiguous in the arrays.
+*/
+int UniformGrid::neighbours(const BallSystem &balls, int i,
+							IndexRange ranges[4]) const
+{
+	int cell = ballCell[i];
+	int cx = cell % columns;
+	int cy = cell / columns;
+	int left = cx > 0 ? cx - 1 : cx;
+	int right = cx + 1 < columns ? cx + 1 : cx;
+	int count = 0;
+
+	for (int row = cy > 0 ? cy - 1 : cy; row <= cy + 1 && row < rows; row++)
+	{
+		count = addRangeWithout(ranges, count, cellStart[row * columns + left],
+			cellStart[row * columns + right + 1], i);
+	}
+
+	return count;
+}
+
+/*****************************************************************************
+							Sweep and prune
+******************************************************************************/
+
+SweepAndPrune::SweepAndPrune() : reach(0.0f)
+{
+}
+
+BroadPhase *SweepAndPrune::clone() const
+{
+	return new SweepAndPrune();
+}
+
+BroadPhaseType SweepAndPrune::type() const
+{
+	return BROAD_PHASE_SWEEP_AND_PRUNE;
+}
+
+const char *SweepAndPrune::name() const
+{
+	return "sweep-and-prune";
+}
+
+/*
+* Insertion sort of the balls along x. The order from the previous step is
+* almost right, so this is close to a single pass. Returns true if the balls
+* were reordered.
+*/
+bool SweepAndPrune::update(BallSystem &balls)
+{
+	const int n = balls.size();
+	const float *x = balls.x;
+	float maxRadius = 0.0f;
+
+	order.resize(n);
+	bool sorted = true;
+
+	for (int i = 0; i < n; i++)
+	{
+		if (balls.radius[i] > maxRadius)
+		{
+			maxRadius = balls.radius[i];
+		}
+
+		int ball = i;
+		int j = i;
+		while (j > 0 && x[order[j - 1]] > x[ball])
+		{
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = ball;
+		sorted = sorted && j == i;
+	}
+
+	reach = 2 * maxRadius * broad_phase_margin;
+
+	if (!sorted)
+	{
+		balls.reorder(&order[0], scratch);
+	}
+
+	return !sorted;
+}
+
+int SweepAndPrune::candidates(const BallSystem &balls, int i,
+							IndexRange ranges[2]) const
+{
+	const int n = balls.size();
+	const float limit = balls.x[i] + reach;
+	int end = i + 1;
+
+	while (end < n && balls.x[end] <= limit)
+	{
+		end++;
+	}
+
+	ranges[0].begin = i + 1;
+	ranges[0].end = end;
+	return 1;
+}
+
+int SweepAndPrune::neighbours(const BallSystem &balls, int i,
+							IndexRange ranges[4]) const
+{
+	const int n = balls.size();
+	int begin = i;
+	int end = i + 1;
+
+	while (begin > 0 && balls.x[begin - 1] >= balls.x[i] - reach)
+	{
+		begin--;
+	}
+
+	while (end < n && balls.x[end] <= balls.x[i] + reach)
+	{
+		end++;
+	}
+
+	return addRangeWithout(ranges, 0, begin, end, i);
+}
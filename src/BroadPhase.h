@@ -0,0 +1,123 @@
+/*
+* Broad-phase collision culling.
+*
+* A broad phase reorders the balls of a BallSystem once per step and then
+* answers two kinds of queries, both as ranges of indices that may touch
+* ball i:
+*	candidates: at most two ranges of indices j > i. Every pair of
+*				overlapping balls shows up in exactly one range of exactly one
+*				of the two balls. Used when most balls move.
+*	neighbours: at most four ranges of indices j != i, in increasing order.
+*				Every ball overlapping i is in one of them. Used when only a
+*				few balls move and only those ask (see World::stepFixed).
+* The ranges are tested with findOverlaps (see NarrowPhase.h), so they have
+* to be contiguous in the arrays; that is why the balls themselves are
+* sorted, which also keeps neighbours close together in memory.
+*
+* Three strategies are provided:
+*	BruteForce: no reordering, one range [i + 1, n). Best for a few balls.
+*	UniformGrid: sort into cells of one ball diameter, look at the cell to the
+*				right and the three cells below, or at all eight cells around.
+*	SweepAndPrune: sort along x, look at the balls whose x interval overlaps.
+*/
+
+#ifndef BROAD_PHASE_H
+#define BROAD_PHASE_H
+
+#include <vector>
+#include "BallSystem.h"
+#include "Table.h"
+
+enum BroadPhaseType
+{
+	BROAD_PHASE_BRUTE_FORCE,
+	BROAD_PHASE_GRID,
+	BROAD_PHASE_SWEEP_AND_PRUNE
+};
+
+struct IndexRange
+{
+	int begin;
+	int end;
+};
+
+class BroadPhase
+{
+	public:
+		virtual ~BroadPhase();
+
+		virtual BroadPhase *clone() const = 0;
+		virtual BroadPhaseType type() const = 0;
+		virtual const char *name() const = 0;
+
+		virtual bool update(BallSystem &balls) = 0;
+		virtual int candidates(const BallSystem &balls, int i,
+								IndexRange ranges[2]) const = 0;
+		virtual int neighbours(const BallSystem &balls, int i,
+								IndexRange ranges[4]) const = 0;
+
+		static BroadPhase *create(BroadPhaseType type, const Table &table,
+								float ballRadius);
+};
+
+class BruteForce : public BroadPhase
+{
+	public:
+		BroadPhase *clone() const;
+		BroadPhaseType type() const;
+		const char *name() const;
+
+		bool update(BallSystem &balls);
+		int candidates(const BallSystem &balls, int i, IndexRange ranges[2]) const;
+		int neighbours(const BallSystem &balls, int i, IndexRange ranges[4]) const;
+};
+
+class UniformGrid : public BroadPhase
+{
+	public:
+		UniformGrid(const Table &table, float ballRadius);
+
+		BroadPhase *clone() const;
+		BroadPhaseType type() const;
+		const char *name() const;
+
+		bool update(BallSystem &balls);
+		int candidates(const BallSystem &balls, int i, IndexRange ranges[2]) const;
+		int neighbours(const BallSystem &balls, int i, IndexRange ranges[4]) const;
+
+	private:
+		int cellOf(float x, float y) const;
+
+		float length;
+		float width;
+		float cellSize;
+		int columns;
+		int rows;
+
+		std::vector<int> cellStart;
+		std::vector<int> ballCell;
+		std::vector<int> order;
+		BallSystem scratch;
+};
+
+class SweepAndPrune : public BroadPhase
+{
+	public:
+		SweepAndPrune();
+
+		BroadPhase *clone() const;
+		BroadPhaseType type() const;
+		const char *name() const;
+
+		bool update(BallSystem &balls);
+		int candidates(const BallSystem &balls, int i, IndexRange ranges[2]) const;
+		int neighbours(const BallSystem &balls, int i, IndexRange ranges[4]) const;
+
+	private:
+		float reach;
+
+		std::vector<int> order;
+		BallSystem scratch;
+};
+
+#endif
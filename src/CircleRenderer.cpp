@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <math.h>
+#include "CircleRenderer.h"
+#include "Trace.h"
+
+// the unit circle vertex is attribute 0, which must always be an array in
+// a compatibility context
+static const GLuint corner_attribute = 0;
+
+static const char *vertex_shader =
+	"#version 120\n"
+	"attribute vec2 corner;\n"
+	"attribute vec3 center;\n" // x, y and radius
+	"attribute vec4 color;\n"
+	"varying vec4 circleColor;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 position = center.xy + corner * center.z;\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+	"	circleColor = color;\n"
+	"}\n";
+
+static const char *fragment_shader =
+	"#version 120\n"
+	"varying vec4 circleColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = circleColor;\n"
+	"}\n";
+
+/*
+* Compile one shader stage. Returns 0 and prints the log on failure.
+*/
+static GLuint compileShader(GLenum type, const char *source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, 0);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), 0, log);
+		fprintf(stderr, "circle shader: %s\n", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+CircleRenderer::CircleRenderer()
+	: segments(0), instanced(false), program(0), meshBuffer(0),
+	instanceBuffer(0), centerAttribute(-1), colorAttribute(-1)
+{
+}
+
+CircleRenderer::~CircleRenderer()
+{
+	release();
+}
+
+/*
+* Build the unit circle and, if the context supports it, the buffers and
+* the shader of the instanced path. Must be called with a current context
+* after glewInit(). Returns whether the instanced path is used.
+*/
+bool CircleRenderer::init(int segments)
+{
+	release();
+
+	this->segments = segments;
+	circle.resize(2 * segments);
+	for (int i = 0; i < segments; i++)
+	{
+		float angle = 2.0f * 3.14159265f * i / segments;
+		circle[2 * i] = cos(angle);
+		circle[2 * i + 1] = sin(angle);
+	}
+
+	instanced = GLEW_VERSION_2_0 && GLEW_ARB_draw_instanced &&
+		GLEW_ARB_instanced_arrays && initInstanced();
+	return instanced;
+}
+
+bool CircleRenderer::initInstanced()
+{
+	GLuint vertex = compileShader(GL_VERTEX_SHADER, vertex_shader);
+	GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragment_shader);
+	if (!vertex || !fragment)
+	{
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+		return false;
+	}
+
+	program = glCreateProgram();
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	glBindAttribLocation(program, corner_attribute, "corner");
+	glLinkProgram(program);
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), 0, log);
+		fprintf(stderr, "circle program: %s\n", log);
+		release();
+		return false;
+	}
+
+	centerAttribute = glGetAttribLocation(program, "center");
+	colorAttribute = glGetAttribLocation(program, "color");
+
+	glGenBuffers(1, &meshBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+	glBufferData(GL_ARRAY_BUFFER, circle.size() * sizeof(GLfloat), &circle[0],
+				GL_STATIC_DRAW);
+
+	glGenBuffers(1, &instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return centerAttribute >= 0 && colorAttribute >= 0;
+}
+
+void CircleRenderer::release()
+{
+	if (program)
+	{
+		glDeleteProgram(program);
+	}
+	if (meshBuffer)
+	{
+		glDeleteBuffers(1, &meshBuffer);
+	}
+	if (instanceBuffer)
+	{
+		glDeleteBuffers(1, &instanceBuffer);
+	}
+
+	program = meshBuffer = instanceBuffer = 0;
+	instanced = false;
+}
+
+bool CircleRenderer::isInstanced() const
+{
+	return instanced;
+}
+
+/*
+* Forget the circles of the last frame.
+*/
+void CircleRenderer::clear()
+{
+	instances.clear();
+}
+
+void CircleRenderer::add(float x, float y, float radius, const GLfloat color[4])
+{
+	Instance instance;
+	instance.x = x;
+	instance.y = y;
+	instance.radius = radius;
+	for (int k = 0; k < 4; k++)
+	{
+		instance.color[k] = color[k];
+	}
+
+	instances.push_back(instance);
+}
+
+/*
+* Draw every circle added since the last clear().
+*/
+void CircleRenderer::draw()
+{
+	TRACE_ZONE("CircleRenderer::draw");
+
+	if (instances.empty())
+	{
+		return;
+	}
+
+	if (instanced)
+		drawInstanced();
+	else
+		drawImmediate();
+}
+
+void CircleRenderer::drawInstanced()
+{
+	glUseProgram(program);
+
+	glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+	glEnableVertexAttribArray(corner_attribute);
+	glVertexAttribPointer(corner_attribute, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// a fresh store every frame, so the driver never waits for the last
+	// frame's draw to finish reading the old one
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance),
+				&instances[0], GL_STREAM_DRAW);
+
+	glEnableVertexAttribArray(centerAttribute);
+	glVertexAttribPointer(centerAttribute, 3, GL_FLOAT, GL_FALSE,
+		sizeof(Instance), (const GLvoid *) offsetof(Instance, x));
+	glVertexAttribDivisorARB(centerAttribute, 1);
+
+	glEnableVertexAttribArray(colorAttribute);
+	glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE,
+		sizeof(Instance), (const GLvoid *) offsetof(Instance, color));
+	glVertexAttribDivisorARB(colorAttribute, 1);
+
+	glDrawArraysInstancedARB(GL_LINE_LOOP, 0, segments,
+							(GLsizei) instances.size());
+
+	glVertexAttribDivisorARB(centerAttribute, 0);
+	glVertexAttribDivisorARB(colorAttribute, 0);
+	glDisableVertexAttribArray(colorAttribute);
+	glDisableVertexAttribArray(centerAttribute);
+	glDisableVertexAttribArray(corner_attribute);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+}
+
+void CircleRenderer::drawImmediate()
+{
+	for (size_t n = 0; n < instances.size(); n++)
+	{
+		const Instance &instance = instances[n];
+
+		glColor4fv(instance.color);
+		glBegin(GL_LINE_LOOP);
+		for (int i = 0; i < segments; i++)
+		{
+			glVertex2f(instance.x + circle[2 * i] * instance.radius,
+					instance.y + circle[2 * i + 1] * instance.radius);
+		}
+		glEnd();
+	}
+}
@@ -0,0 +1,67 @@
+/*
+* Draws many circle outlines with one draw call.
+*
+* A unit circle is uploaded into a vertex buffer once. Every frame the
+* circles to draw are collected with add() and drawn by draw() in a single
+* instanced call: the position, radius and color of each circle go into a
+* second buffer that advances once per instance, and a small shader places
+* the unit circle accordingly. The coordinates are transformed by the
+* current modelview and projection matrices.
+*
+* The instanced path needs OpenGL 2.0 shaders and ARB_draw_instanced with
+* ARB_instanced_arrays, which Mesa's software rasterizer provides. Without
+* them the circles are drawn in immediate mode from the same precomputed
+* unit circle.
+*/
+
+#ifndef CIRCLE_RENDERER_H
+#define CIRCLE_RENDERER_H
+
+#include <vector>
+#include <GL/glew.h>
+
+const int circle_segments = 64;
+
+class CircleRenderer
+{
+	public:
+		CircleRenderer();
+		~CircleRenderer();
+
+		bool init(int segments = circle_segments);
+		bool isInstanced() const;
+
+		void clear();
+		void add(float x, float y, float radius, const GLfloat color[4]);
+		void draw();
+
+	private:
+		struct Instance
+		{
+			GLfloat x;
+			GLfloat y;
+			GLfloat radius;
+			GLfloat color[4];
+		};
+
+		CircleRenderer(const CircleRenderer &);
+		CircleRenderer &operator=(const CircleRenderer &);
+
+		bool initInstanced();
+		void release();
+		void drawInstanced();
+		void drawImmediate();
+
+		int segments;
+		std::vector<GLfloat> circle; // x, y of every vertex
+		std::vector<Instance> instances;
+
+		bool instanced;
+		GLuint program;
+		GLuint meshBuffer;
+		GLuint instanceBuffer;
+		GLint centerAttribute;
+		GLint colorAttribute;
+};
+
+#endif
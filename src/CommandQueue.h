@@ -0,0 +1,125 @@
+/*
+* A bounded queue from exactly one thread to exactly one other, without
+* locks or compare and swap.
+*
+* The queue is a ring indexed by two counters that only ever grow: the
+* producer alone advances the tail, the consumer alone the head. So neither
+* end has to claim anything; push() writes the cell and then publishes the
+* new tail, pop() reads the cell and then publishes the new head, each with
+* one plain atomic store. Each side also keeps the last value it saw of the
+* other's counter and only reads the real one again when that copy says
+* the queue is full or empty, so in the common case neither touches the
+* other's cache line. push() and pop() return false instead of waiting
+* when the queue is full or empty.
+*
+* With more than one producer or consumer use ResultQueue.h instead.
+*/
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+template <class T>
+class CommandQueue
+{
+	public:
+		CommandQueue(int capacity = 64);
+		~CommandQueue();
+
+		bool push(const T &value);
+		bool pop(T &value);
+		int capacity() const;
+
+	private:
+		CommandQueue(const CommandQueue &);
+		CommandQueue &operator=(const CommandQueue &);
+
+		T *cells;
+		size_t mask;
+
+		// written by the producer
+		alignas(64) std::atomic<size_t> tail; // next cell to push
+		size_t headSeen;
+
+		// written by the consumer
+		alignas(64) std::atomic<size_t> head; // next cell to pop
+		size_t tailSeen;
+};
+
+/*
+* The capacity is rounded up to a power of two.
+*/
+template <class T>
+CommandQueue<T>::CommandQueue(int capacity)
+	: tail(0), headSeen(0), head(0), tailSeen(0)
+{
+	size_t size = 2;
+	while (size < (size_t) capacity)
+	{
+		size *= 2;
+	}
+
+	cells = new T[size];
+	mask = size - 1;
+}
+
+template <class T>
+CommandQueue<T>::~CommandQueue()
+{
+	delete[] cells;
+}
+
+template <class T>
+int CommandQueue<T>::capacity() const
+{
+	return (int) (mask + 1);
+}
+
+/*
+* Append a copy of value. Producer only. Returns false if the queue is
+* full.
+*/
+template <class T>
+bool CommandQueue<T>::push(const T &value)
+{
+	size_t position = tail.load(std::memory_order_relaxed);
+
+	if (position - headSeen > mask)
+	{
+		headSeen = head.load(std::memory_order_acquire);
+		if (position - headSeen > mask)
+		{
+			return false;
+		}
+	}
+
+	cells[position & mask] = value;
+	tail.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+/*
+* Take the oldest value. Consumer only. Returns false if the queue is empty.
+*/
+template <class T>
+bool CommandQueue<T>::pop(T &value)
+{
+	size_t position = head.load(std::memory_order_relaxed);
+
+	if (position == tailSeen)
+	{
+		tailSeen = tail.load(std::memory_order_acquire);
+		if (position == tailSeen)
+		{
+			return false;
+		}
+	}
+
+	value = cells[position & mask];
+	head.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+#endif
@@ -0,0 +1,424 @@
+#include <math.h>
+#include "EventEngine.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "World.h"
+
+// rate of the continuous decay that matches velocity_damping per frame
+static const double decay_rate = -log((double) velocity_damping) / frame_time;
+
+/*
+* Distance factor s(t) covered in time t by a ball with unit start speed.
+*/
+static double travel(double t)
+{
+	return -expm1(-decay_rate * t) / decay_rate;
+}
+
+/*
+* Inverse of travel(): the time it takes to cover the distance factor s.
+* A decaying ball never gets further than 1 / decay_rate, so beyond that
+* the answer is infinite.
+*/
+static double travelTime(double s)
+{
+	if (decay_rate * s >= 1.0)
+	{
+		return HUGE_VAL;
+	}
+
+	return -log1p(-decay_rate * s) / decay_rate;
+}
+
+EventEngine::EventEngine() : valid(false), now(0.0), processed(0)
+{
+}
+
+/*
+* Throw away all predictions. Must be called whenever the balls are changed
+* from outside, e.g. by a shot or a new rack.
+*/
+void EventEngine::invalidate()
+{
+	valid = false;
+}
+
+/*
+* Process every event in the next timePassed seconds and leave all balls at
+* the end of that interval. Returns the number of balls that fell into a
+* pocket; scratched is set if the cue ball reached a pocket mouth.
+*/
+int EventEngine::advance(BallSystem &balls, const Table &table, float timePassed,
+						bool &scratched)
+{
+	TRACE_ZONE("EventEngine::advance");
+
+	if (!valid)
+	{
+		start(balls, table);
+	}
+
+	double until = now + timePassed;
+	int pocketed = run(balls, table, until, scratched);
+
+	now = until;
+	for (int i = 0; i < balls.size(); i++)
+	{
+		moveTo(balls, i, now);
+	}
+
+	return pocketed;
+}
+
+/*
+* Process events until every ball has stopped or maxTime seconds have been
+* simulated, and leave all balls at that moment. Returns the number of events
+* that were processed.
+*/
+int EventEngine::advanceToRest(BallSystem &balls, const Table &table,
+								float maxTime, bool &scratched)
+{
+	if (!valid)
+	{
+		start(balls, table);
+	}
+
+	long before = processed;
+	double until = now + maxTime;
+	run(balls, table, until, scratched);
+
+	if (!queue.empty())
+	{
+		now = until;
+	}
+	for (int i = 0; i < balls.size(); i++)
+	{
+		moveTo(balls, i, now);
+	}
+
+	return (int) (processed - before);
+}
+
+long EventEngine::eventsProcessed() const
+{
+	return processed;
+}
+
+/*
+* Predict the first events of every ball from scratch.
+*/
+void EventEngine::start(BallSystem &balls, const Table &table)
+{
+	TRACE_ZONE("EventEngine::start");
+
+	const int n = balls.size();
+
+	now = 0.0;
+	ballTime.assign(n, now);
+	ballCount.assign(n, 0);
+	queue = std::priority_queue<Event, std::vector<Event>, LaterEvent>();
+
+	for (int i = 0; i < n; i++)
+	{
+		if (!balls.active[i])
+		{
+			continue;
+		}
+
+		// two balls at rest never meet, so only pairs with a moving ball
+		// are predicted
+		bool resting = balls.vx[i] == 0.0f && balls.vy[i] == 0.0f;
+
+		predictRails(balls, table, i);
+		for (int j = i + 1; j < n; j++)
+		{
+			if (balls.active[j] && !(resting && balls.vx[j] == 0.0f &&
+				balls.vy[j] == 0.0f))
+			{
+				predictPair(balls, i, j);
+			}
+		}
+	}
+
+	valid = true;
+}
+
+/*
+* Process the queued events up to the given time. Returns the number of
+* pocketed balls.
+*/
+int EventEngine::run(BallSystem &balls, const Table &table, double until,
+					bool &scratched)
+{
+	int pocketed = 0;
+
+	while (!queue.empty() && queue.top().time <= until)
+	{
+		Event event = queue.top();
+		queue.pop();
+
+		// one of the balls has changed course since this was predicted
+		if (event.countA != ballCount[event.a] ||
+			(event.type == EVENT_BALL && event.countB != ballCount[event.b]))
+		{
+			continue;
+		}
+
+		if (process(balls, table, event, scratched))
+		{
+			pocketed++;
+		}
+		processed++;
+	}
+
+	return pocketed;
+}
+
+/*
+* Bring ball i forward along its current path to the given time. Pocketed
+* balls stay where they are.
+*/
+void EventEngine::moveTo(BallSystem &balls, int i, double time)
+{
+	double dt = time - ballTime[i];
+
+	if (dt > 0.0 && balls.active[i] &&
+		(balls.vx[i] != 0.0f || balls.vy[i] != 0.0f))
+	{
+		double s = travel(dt);
+		double decay = exp(-decay_rate * dt);
+
+		balls.x[i] += (float) (balls.vx[i] * s);
+		balls.y[i] += (float) (balls.vy[i] * s);
+		balls.vx[i] = (float) (balls.vx[i] * decay);
+		balls.vy[i] = (float) (balls.vy[i] * decay);
+	}
+
+	ballTime[i] = time;
+}
+
+/*
+* Absolute time at which ball i will have slowed down to rest_speed, or
+* infinity for a ball that is not moving.
+*/
+double EventEngine::stopTime(const BallSystem &balls, int i) const
+{
+	double speed = sqrt((double) balls.vx[i] * balls.vx[i] +
+						(double) balls.vy[i] * balls.vy[i]);
+
+	if (speed == 0.0)
+	{
+		return HUGE_VAL;
+	}
+	if (speed <= rest_speed)
+	{
+		return ballTime[i];
+	}
+
+	return ballTime[i] + log(speed / rest_speed) / decay_rate;
+}
+
+/*
+* Predict every event of ball i from now on. All other balls are brought to
+* the current time first.
+*/
+void EventEngine::predict(BallSystem &balls, const Table &table, int i)
+{
+	predictRails(balls, table, i);
+
+	for (int j = 0; j < balls.size(); j++)
+	{
+		if (j != i && balls.active[j])
+		{
+			moveTo(balls, j, now);
+			predictPair(balls, i, j);
+		}
+	}
+}
+
+/*
+* Queue the first rail contact of ball i and the moment it comes to rest.
+* Ball i must be at the current time.
+*/
+void EventEngine::predictRails(const BallSystem &balls, const Table &table,
+								int i)
+{
+	const double x = balls.x[i];
+	const double y = balls.y[i];
+	const double vx = balls.vx[i];
+	const double vy = balls.vy[i];
+	const double r = balls.radius[i];
+	const double stop = stopTime(balls, i);
+
+	if (vx != 0.0)
+	{
+		Rail rail = vx < 0.0 ? LEFT_RAIL : RIGHT_RAIL;
+		double s = ((vx < 0.0 ? r : table.length - r) - x) / vx;
+		double time = now + travelTime(s > 0.0 ? s : 0.0);
+
+		if (time <= stop)
+		{
+			push(EVENT_RAIL, time, i, rail);
+		}
+	}
+
+	if (vy != 0.0)
+	{
+		Rail rail = vy < 0.0 ? TOP_RAIL : BOTTOM_RAIL;
+		double s = ((vy < 0.0 ? r : table.width - r) - y) / vy;
+		double time = now + travelTime(s > 0.0 ? s : 0.0);
+
+		if (time <= stop)
+		{
+			push(EVENT_RAIL, time, i, rail);
+		}
+	}
+
+	if (stop != HUGE_VAL)
+	{
+		push(EVENT_STOP, stop, i, -1);
+	}
+}
+
+/*
+* Queue the next contact between balls i and j, if they ever touch before
+* one of them stops. Both balls must be at the current time.
+*/
+void EventEngine::predictPair(const BallSystem &balls, int i, int j)
+{
+	COUNT_STAT(pairTests, 1);
+
+	const double dx = (double) balls.x[j] - balls.x[i];
+	const double dy = (double) balls.y[j] - balls.y[i];
+	const double dvx = (double) balls.vx[j] - balls.vx[i];
+	const double dvy = (double) balls.vy[j] - balls.vy[i];
+
+	// half of the linear coefficient; the balls only meet when approaching
+	const double b = dx * dvx + dy * dvy;
+	if (b >= 0.0)
+	{
+		return;
+	}
+
+	// touching balls that close in slower than rest_speed are at rest
+	// against each other; a contact now would only hand a rounding error
+	// back and forth without time moving on
+	const double distanceSquared = dx * dx + dy * dy;
+	if (b * b <= (double) rest_speed * rest_speed * distanceSquared)
+	{
+		return;
+	}
+
+	const double a = dvx * dvx + dvy * dvy;
+	const double r = (double) balls.radius[i] + balls.radius[j];
+	const double c = distanceSquared - r * r;
+	double s = 0.0;
+
+	if (c > 0.0)
+	{
+		double discriminant = b * b - a * c;
+		if (discriminant < 0.0)
+		{
+			return;
+		}
+
+		// smaller root of a s^2 + 2 b s + c, in the form that does not
+		// cancel for nearly parallel paths
+		s = c / (-b + sqrt(discriminant));
+	}
+
+	double time = now + travelTime(s);
+	if (time > stopTime(balls, i) || time > stopTime(balls, j))
+	{
+		return;
+	}
+
+	push(EVENT_BALL, time, i, j);
+}
+
+void EventEngine::push(EventType type, double time, int a, int b)
+{
+	Event event;
+	event.time = time;
+	event.type = type;
+	event.a = a;
+	event.b = b;
+	event.countA = ballCount[a];
+	event.countB = type == EVENT_BALL ? ballCount[b] : 0;
+	queue.push(event);
+}
+
+/*
+* Apply one event and predict the new events of the balls involved. Returns
+* true if a ball fell into a pocket.
+*/
+bool EventEngine::process(BallSystem &balls, const Table &table,
+						const Event &event, bool &scratched)
+{
+	const int a = event.a;
+	now = event.time;
+	moveTo(balls, a, now);
+
+	if (event.type == EVENT_BALL)
+	{
+		const int b = event.b;
+		moveTo(balls, b, now);
+
+		// swap the velocity components along the line between the centers,
+		// as World's collide does for two equal balls
+		float nx = balls.x[b] - balls.x[a];
+		float ny = balls.y[b] - balls.y[a];
+		float length = sqrt(nx * nx + ny * ny);
+		if (length > 0.0f)
+		{
+			nx /= length;
+			ny /= length;
+		}
+
+		float exchange = (balls.vx[b] - balls.vx[a]) * nx +
+						(balls.vy[b] - balls.vy[a]) * ny;
+		balls.vx[a] += exchange * nx;
+		balls.vy[a] += exchange * ny;
+		balls.vx[b] -= exchange * nx;
+		balls.vy[b] -= exchange * ny;
+
+		COUNT_STAT(collisions, 1);
+		ballCount[a]++;
+		ballCount[b]++;
+		predict(balls, table, a);
+		predict(balls, table, b);
+		return false;
+	}
+
+	ballCount[a]++;
+
+	if (event.type == EVENT_RAIL)
+	{
+		Rail rail = (Rail) event.b;
+
+		// the cue ball bounces back out of a pocket, as in World
+		if (table.isPocketMouth(rail, balls.x[a], balls.y[a]))
+		{
+			if (balls.id[a] != 0)
+			{
+				balls.active[a] = 0;
+				return true;
+			}
+			scratched = true;
+		}
+
+		if (rail == LEFT_RAIL || rail == RIGHT_RAIL)
+			balls.vx[a] = -balls.vx[a];
+		else
+			balls.vy[a] = -balls.vy[a];
+		COUNT_STAT(cushionHits, 1);
+	}
+	else
+	{
+		balls.vx[a] = 0.0f;
+		balls.vy[a] = 0.0f;
+	}
+
+	predict(balls, table, a);
+	return false;
+}
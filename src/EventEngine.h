@@ -0,0 +1,92 @@
+/*
+* Event-driven simulation, an alternative to stepping by a fixed frame_time.
+*
+* Instead of moving every ball by a fixed step and looking for overlaps
+* afterwards, the event engine computes when the next ball-ball contact,
+* cushion bounce, pocket drop or stop happens and jumps straight to it.
+*
+* Between events a ball slows down continuously at the rate the fixed
+* stepper applies once per frame: v(t) = v0 e^(-kt) with
+* k = -ln(velocity_damping) / frame_time. Its position is then
+* p(t) = p0 + v0 s(t) with s(t) = (1 - e^(-kt)) / k. Since s(t) is the same
+* for every ball, a contact between two balls is a quadratic in s and a
+* cushion contact is linear in s. A ball drops into a pocket when it reaches
+* a rail inside a pocket mouth, and it stops once its speed falls below
+* rest_speed.
+*
+* Events wait in a priority queue. Every ball has a counter that goes up
+* whenever its velocity changes; events predicted with an older counter are
+* dropped when they reach the front. So after an event only the events of
+* the balls that took part in it are computed again. Each ball also has its
+* own time stamp and is only moved forward when it takes part in an event or
+* when the caller needs the state at a given time.
+*/
+
+#ifndef EVENT_ENGINE_H
+#define EVENT_ENGINE_H
+
+#include <queue>
+#include <vector>
+#include "BallSystem.h"
+#include "Table.h"
+
+class EventEngine
+{
+	public:
+		EventEngine();
+
+		void invalidate();
+		int advance(BallSystem &balls, const Table &table, float timePassed,
+					bool &scratched);
+		int advanceToRest(BallSystem &balls, const Table &table, float maxTime,
+					bool &scratched);
+
+		long eventsProcessed() const;
+
+	private:
+		enum EventType
+		{
+			EVENT_BALL,
+			EVENT_RAIL,
+			EVENT_STOP
+		};
+
+		struct Event
+		{
+			double time;
+			EventType type;
+			int a;
+			int b; // the other ball, or the Rail for EVENT_RAIL
+			int countA;
+			int countB;
+		};
+
+		struct LaterEvent
+		{
+			bool operator()(const Event &lhs, const Event &rhs) const
+			{
+				return lhs.time > rhs.time;
+			}
+		};
+
+		void start(BallSystem &balls, const Table &table);
+		int run(BallSystem &balls, const Table &table, double until,
+				bool &scratched);
+		void moveTo(BallSystem &balls, int i, double time);
+		double stopTime(const BallSystem &balls, int i) const;
+		void predict(BallSystem &balls, const Table &table, int i);
+		void predictRails(const BallSystem &balls, const Table &table, int i);
+		void predictPair(const BallSystem &balls, int i, int j);
+		void push(EventType type, double time, int a, int b);
+		bool process(BallSystem &balls, const Table &table, const Event &event,
+					bool &scratched);
+
+		bool valid;
+		double now;
+		long processed;
+		std::vector<double> ballTime;
+		std::vector<int> ballCount;
+		std::priority_queue<Event, std::vector<Event>, LaterEvent> queue;
+};
+
+#endif
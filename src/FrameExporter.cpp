@@ -0,0 +1,199 @@
+#include <string.h>
+#include "FrameExporter.h"
+
+#if defined(_WIN32)
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
+
+FrameExporter::FrameExporter()
+	: file(0), width(0), height(0), frames(0), failed(false),
+	allocated(false), async(false)
+{
+	buffers[0] = buffers[1] = 0;
+}
+
+FrameExporter::~FrameExporter()
+{
+	close();
+}
+
+/*
+* Start writing frames of width x height pixels to the file at path, or to
+* standard output if path is "-". No GL calls are made until the first
+* capture().
+*/
+bool FrameExporter::open(const char *path, int width, int height)
+{
+	close();
+
+	if (strcmp(path, "-") == 0)
+	{
+		// keep the real standard output for the frames and send whatever
+		// else is printed to stderr
+		fflush(stdout);
+		int fd = dup(fileno(stdout));
+		if (fd < 0 || dup2(fileno(stderr), fileno(stdout)) < 0)
+			return false;
+		file = fdopen(fd, "wb");
+	}
+	else
+	{
+		file = fopen(path, "wb");
+	}
+
+	if (!file)
+		return false;
+
+	this->width = width;
+	this->height = height;
+	frames = 0;
+	failed = false;
+	return true;
+}
+
+/*
+* Write out the last captured frame and close the output. Returns false if
+* any frame could not be written.
+*/
+bool FrameExporter::close()
+{
+	if (!file)
+		return false;
+
+	if (async && frames > 0 && !failed)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[(frames - 1) % 2]);
+		write(0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	release();
+	bool ok = fclose(file) == 0 && !failed;
+	file = 0;
+	return ok;
+}
+
+bool FrameExporter::isOpen() const
+{
+	return file != 0;
+}
+
+void FrameExporter::allocate()
+{
+	const size_t size = (size_t) width * height * 3;
+
+	async = GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+	if (async)
+	{
+		glGenBuffers(2, buffers);
+		for (int i = 0; i < 2; i++)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, size, 0, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	else
+	{
+		pixels.resize(size);
+	}
+
+	rows.resize(size);
+	allocated = true;
+}
+
+void FrameExporter::release()
+{
+	if (buffers[0])
+	{
+		glDeleteBuffers(2, buffers);
+	}
+
+	buffers[0] = buffers[1] = 0;
+	allocated = false;
+	async = false;
+}
+
+/*
+* Capture the current frame from the read buffer of the bound framebuffer.
+* With pixel buffer objects this writes out the frame captured before.
+* Returns false once writing failed.
+*/
+bool FrameExporter::capture()
+{
+	if (!file || failed)
+		return false;
+
+	if (!allocated)
+	{
+		allocate();
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	if (async)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[frames % 2]);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+
+		if (frames > 0)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[(frames - 1) % 2]);
+			write(0);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	else
+	{
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE,
+			&pixels[0]);
+		write(&pixels[0]);
+	}
+
+	frames++;
+	return !failed;
+}
+
+int FrameExporter::numOfFrames() const
+{
+	return frames;
+}
+
+/*
+* Write one frame, bottom row first as OpenGL returns it. Null pixels mean
+* the pixel buffer object bound to GL_PIXEL_PACK_BUFFER.
+*/
+bool FrameExporter::write(const unsigned char *pixels)
+{
+	bool mapped = pixels == 0;
+	if (mapped)
+	{
+		pixels = (const unsigned char *)
+			glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (!pixels)
+		{
+			failed = true;
+			return false;
+		}
+	}
+
+	const size_t stride = (size_t) width * 3;
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(&rows[y * stride], pixels + (height - 1 - y) * stride, stride);
+	}
+
+	if (mapped)
+	{
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+
+	if (fwrite(&rows[0], 1, rows.size(), file) != rows.size())
+	{
+		failed = true;
+	}
+
+	return !failed;
+}
@@ -0,0 +1,64 @@
+/*
+* Writes rendered frames out as raw video.
+*
+* Every frame is appended to the output as width x height RGB pixels, one
+* byte per channel, top row first and without any header, which is what
+* e.g. `ffmpeg -f rawvideo -pix_fmt rgb24 -s 980x530 -i -` reads.
+*
+* Reading pixels back normally makes the CPU wait until the GPU has finished
+* the frame. Here capture() only asks for the pixels of the current frame to
+* be copied into one of two pixel buffer objects and then writes out the
+* frame captured before it from the other one. That frame has long been
+* finished, so the next frame is drawn while the last one is written. The
+* final frame is written by close().
+*
+* Without pixel buffer objects (OpenGL 2.1 or ARB_pixel_buffer_object) the
+* pixels are read back synchronously.
+*
+* The output "-" means standard output. The exporter then takes the real
+* standard output for itself and points stdout at stderr, so messages
+* printed during the export do not end up in the video.
+*/
+
+#ifndef FRAME_EXPORTER_H
+#define FRAME_EXPORTER_H
+
+#include <stdio.h>
+#include <vector>
+#include <GL/glew.h>
+
+class FrameExporter
+{
+	public:
+		FrameExporter();
+		~FrameExporter();
+
+		bool open(const char *path, int width, int height);
+		bool close();
+		bool isOpen() const;
+
+		bool capture();
+		int numOfFrames() const;
+
+	private:
+		FrameExporter(const FrameExporter &);
+		FrameExporter &operator=(const FrameExporter &);
+
+		void allocate();
+		void release();
+		bool write(const unsigned char *pixels);
+
+		FILE *file;
+		int width;
+		int height;
+		int frames;
+		bool failed;
+
+		bool allocated;
+		bool async;
+		GLuint buffers[2];
+		std::vector<unsigned char> pixels; // synchronous readback
+		std::vector<unsigned char> rows; // the frame flipped top side up
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include <chrono>
+#include "FrameScheduler.h"
+
+/*
+* Nanoseconds since an arbitrary but fixed point, never going backwards.
+*/
+long long monotonicNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FrameScheduler::FrameScheduler(float stepTime, int maxStepsPerFrame)
+	: step(stepTime), stepLength((long long) (stepTime * 1e9 + 0.5)),
+	maxSteps(maxStepsPerFrame),
+	last(0), accumulator(0), started(false)
+{
+}
+
+/*
+* Forget the accumulated time. The next frame starts counting afresh.
+*/
+void FrameScheduler::reset()
+{
+	accumulator = 0;
+	started = false;
+}
+
+/*
+* Account for the time passed since the last frame and return the number of
+* physics steps to take now. The first frame after a reset takes none.
+*/
+int FrameScheduler::frame(long long now)
+{
+	if (!started)
+	{
+		last = now;
+		started = true;
+		return 0;
+	}
+
+	accumulator += now - last;
+	last = now;
+
+	long long steps = accumulator / stepLength;
+	accumulator -= steps * stepLength;
+
+	// too far behind: drop the time that cannot be made up
+	if (steps > maxSteps)
+	{
+		steps = maxSteps;
+	}
+
+	return (int) steps;
+}
+
+float FrameScheduler::stepTime() const
+{
+	return step;
+}
+
+/*
+* How far the real time is into the next step, between 0 and 1.
+*/
+float FrameScheduler::alpha() const
+{
+	return (float) accumulator / stepLength;
+}
@@ -0,0 +1,46 @@
+/*
+* Fixed time step scheduling for an interactive loop.
+*
+* The physics always advances in steps of the same length, no matter how
+* often the loop runs. Every frame the real time that passed is added to an
+* accumulator and as many whole steps as fit are taken; the rest carries over
+* to the next frame. The leftover fraction of a step, alpha(), is used to
+* blend the previous and the current ball positions when drawing, so the
+* picture moves smoothly even when the render rate is not a multiple of the
+* physics rate.
+*
+* When a frame takes too long (a debugger, a stalled driver) at most
+* maxStepsPerFrame steps are taken and the remaining time is dropped, rather
+* than trying to catch up and falling further behind every frame.
+*
+* Time is counted in integer nanoseconds from a monotonic clock, so the
+* number of steps does not drift and does not depend on the speed of the
+* host.
+*/
+
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+long long monotonicNanoseconds();
+
+class FrameScheduler
+{
+	public:
+		FrameScheduler(float stepTime, int maxStepsPerFrame = 5);
+
+		void reset();
+		int frame(long long now);
+
+		float stepTime() const;
+		float alpha() const;
+
+	private:
+		float step;
+		long long stepLength;
+		int maxSteps;
+		long long last;
+		long long accumulator;
+		bool started;
+};
+
+#endif
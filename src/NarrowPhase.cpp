@@ -0,0 +1,275 @@
+#include <math.h>
+#include "NarrowPhase.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#	define BILLIARD_X86_KERNELS
+#	include <immintrin.h>
+#endif
+
+typedef int (*OverlapFunction)(const float *x, const float *y,
+	const float *radius, int i, int begin, int end, int *hits);
+
+/*
+* Write the index of every ball j in [begin, end) that overlaps ball i into
+* hits and return how many there are. The hits are in increasing order.
+*/
+static int overlapsScalar(const float *x, const float *y, const float *radius,
+	int i, int begin, int end, int *hits)
+{
+	const float xi = x[i];
+	const float yi = y[i];
+	const float ri = radius[i];
+	int count = 0;
+
+	for (int j = begin; j < end; j++)
+	{
+		float dx = x[j] - xi;
+		float dy = y[j] - yi;
+		float r = radius[j] + ri;
+
+		if (dx * dx + dy * dy <= r * r)
+		{
+			hits[count++] = j;
+		}
+	}
+
+	return count;
+}
+
+#ifdef BILLIARD_X86_KERNELS
+
+/*
+* Append the lanes set in mask, offset by j, to hits.
+*/
+static inline int appendHits(unsigned mask, int j, int *hits, int count)
+{
+	while (mask)
+	{
+		hits[count++] = j + __builtin_ctz(mask);
+		mask &= mask - 1;
+	}
+
+	return count;
+}
+
+__attribute__((target("sse2")))
+static int overlapsSSE(const float *x, const float *y, const float *radius,
+	int i, int begin, int end, int *hits)
+{
+	const __m128 xi = _mm_set1_ps(x[i]);
+	const __m128 yi = _mm_set1_ps(y[i]);
+	const __m128 ri = _mm_set1_ps(radius[i]);
+	int count = 0;
+	int j = begin;
+
+	for (; j + 4 <= end; j += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(x + j), xi);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(y + j), yi);
+		__m128 r = _mm_add_ps(_mm_loadu_ps(radius + j), ri);
+		__m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		unsigned mask = _mm_movemask_ps(_mm_cmple_ps(d2, _mm_mul_ps(r, r)));
+
+		count = appendHits(mask, j, hits, count);
+	}
+
+	return count + overlapsScalar(x, y, radius, i, j, end, hits + count);
+}
+
+__attribute__((target("avx2")))
+static int overlapsAVX2(const float *x, const float *y, const float *radius,
+	int i, int begin, int end, int *hits)
+{
+	const __m256 xi = _mm256_set1_ps(x[i]);
+	const __m256 yi = _mm256_set1_ps(y[i]);
+	const __m256 ri = _mm256_set1_ps(radius[i]);
+	int count = 0;
+	int j = begin;
+
+	for (; j + 8 <= end; j += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + j), xi);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + j), yi);
+		__m256 r = _mm256_add_ps(_mm256_loadu_ps(radius + j), ri);
+		__m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		unsigned mask = _mm256_movemask_ps(
+			_mm256_cmp_ps(d2, _mm256_mul_ps(r, r), _CMP_LE_OQ));
+
+		count = appendHits(mask, j, hits, count);
+	}
+
+	// the tail is done in scalar code: handing it to the legacy encoded SSE
+	// kernel would pay for the switch between AVX and SSE state
+	return count + overlapsScalar(x, y, radius, i, j, end, hits + count);
+}
+
+#endif
+
+static OverlapFunction kernelFunction(OverlapKernel kernel)
+{
+	switch (kernel)
+	{
+		case OVERLAP_SCALAR:
+			return overlapsScalar;
+#ifdef BILLIARD_X86_KERNELS
+		case OVERLAP_SSE:
+			return __builtin_cpu_supports("sse2") ? overlapsSSE : 0;
+		case OVERLAP_AVX2:
+			return __builtin_cpu_supports("avx2") ? overlapsAVX2 : 0;
+		case OVERLAP_AUTO:
+			if (__builtin_cpu_supports("avx2"))
+				return overlapsAVX2;
+			if (__builtin_cpu_supports("sse2"))
+				return overlapsSSE;
+			return overlapsScalar;
+#else
+		case OVERLAP_AUTO:
+			return overlapsScalar;
+#endif
+		default:
+			return 0;
+	}
+}
+
+/*
+* The kernel in use. It is detected the first time it is needed; the
+* initialization of the static is thread safe.
+*/
+static OverlapFunction &currentKernel()
+{
+	static OverlapFunction kernel = kernelFunction(OVERLAP_AUTO);
+	return kernel;
+}
+
+int findOverlaps(const BallSystem &balls, int i, int begin, int end, int *hits)
+{
+	return currentKernel()(balls.x, balls.y, balls.radius, i, begin, end, hits);
+}
+
+/*
+* Force a specific kernel, e.g. to compare them in a benchmark. Returns false
+* and keeps the current kernel if the CPU does not support the requested one.
+* This is not thread safe; call it before any world is stepped.
+*/
+bool setOverlapKernel(OverlapKernel kernel)
+{
+	OverlapFunction function = kernelFunction(kernel);
+
+	if (!function)
+	{
+		return false;
+	}
+
+	currentKernel() = function;
+	return true;
+}
+
+const char *overlapKernelName()
+{
+	OverlapFunction kernel = currentKernel();
+
+#ifdef BILLIARD_X86_KERNELS
+	if (kernel == overlapsAVX2)
+		return "avx2";
+	if (kernel == overlapsSSE)
+		return "sse";
+#endif
+	return "scalar";
+}
+
+/*
+* Move two overlapping balls back to the point in the frame where they first
+* touched. Returns the time that is left in the frame after the contact.
+* The balls are entries i and j of the arrays.
+*/
+real collisionPoint(float *x, float *y, const float *vx, const float *vy,
+					int i, int j, real frameTime, real distanceAtFrameEnd,
+					real collisionDistance)
+{
+	Vec2<real> ball1Velocity(vx[i], vy[i]);
+	Vec2<real> ball2Velocity(vx[j], vy[j]);
+	Vec2<real> ball1FrameStartPosition = Vec2<real>(x[i], y[i]) - (frameTime * ball1Velocity);
+	Vec2<real> ball2FrameStartPosition = Vec2<real>(x[j], y[j]) - (frameTime * ball2Velocity);
+
+	real distanceAtFrameStart = length(ball2FrameStartPosition - ball1FrameStartPosition);
+
+	real collisionTime = frameTime * (distanceAtFrameStart - collisionDistance ) / (distanceAtFrameStart - distanceAtFrameEnd) ;
+
+	// balls that already touched at the start of the frame (or were not
+	// approaching) give a time outside the frame, which would throw them
+	// across the table in crowded scenes
+	if (!(collisionTime >= 0))
+		collisionTime = 0;
+	else if (collisionTime > frameTime)
+		collisionTime = frameTime;
+
+	Vec2<real> ball1Position = ball1FrameStartPosition + (collisionTime * ball1Velocity);
+	Vec2<real> ball2Position = ball2FrameStartPosition + (collisionTime * ball2Velocity);
+
+	x[i] = ball1Position.x;
+	y[i] = ball1Position.y;
+	x[j] = ball2Position.x;
+	y[j] = ball2Position.y;
+
+	return (frameTime - collisionTime);
+}
+
+real collisionPoint(BallSystem &balls, int i, int j, real frameTime,
+							real distanceAtFrameEnd, real collisionDistance)
+{
+	return collisionPoint(balls.x, balls.y, balls.vx, balls.vy, i, j,
+		frameTime, distanceAtFrameEnd, collisionDistance);
+}
+
+/*
+* Resolve the collision of balls i and j if they overlap at the end of a
+* step of frameTime seconds: both are moved back to where they first
+* touched, exchange the normal components of their velocities and move on
+* for the rest of the step. The balls are entries i and j of the arrays, so
+* this works on any layout, e.g. the lanes of a TableBatch.
+*/
+void collide(float *x, float *y, float *vx, float *vy, const float *radius,
+			int i, int j, real frameTime)
+{
+	Vec2<real> normalPlane = Vec2<real>(x[j], y[j]) - Vec2<real>(x[i], y[i]);
+	real distanceAtFrameEnd = length(normalPlane);
+
+	real collisionDistance = (real) radius[i] + radius[j];
+
+	if (distanceAtFrameEnd <= collisionDistance)
+	{
+		real collisionTime = collisionPoint(x, y, vx, vy, i, j, frameTime,
+			distanceAtFrameEnd, collisionDistance);
+
+		normalPlane = normalized(normalPlane);
+
+		Vec2<real> collisionPlane = perpendicular(normalPlane);
+
+		Vec2<real> ball1Velocity(vx[i], vy[i]);
+		Vec2<real> ball2Velocity(vx[j], vy[j]);
+
+		real n_vel2 = dot(normalPlane, ball1Velocity);
+		real c_vel1 = dot(collisionPlane, ball1Velocity);
+		real n_vel1 = dot(normalPlane, ball2Velocity);
+		real c_vel2 = dot(collisionPlane, ball2Velocity);
+
+		Vec2<real> vel1 = (n_vel1 * normalPlane) + (c_vel1 * collisionPlane);
+		Vec2<real> vel2 = (n_vel2 * normalPlane) + (c_vel2 * collisionPlane);
+
+		x[i] += collisionTime * vel1.x;
+		y[i] += collisionTime * vel1.y;
+		x[j] += collisionTime * vel2.x;
+		y[j] += collisionTime * vel2.y;
+
+		vx[i] = vel1.x;
+		vy[i] = vel1.y;
+		vx[j] = vel2.x;
+		vy[j] = vel2.y;
+	}
+}
+
+void collide(BallSystem &balls, int i, int j, real frameTime)
+{
+	collide(balls.x, balls.y, balls.vx, balls.vy, balls.radius, i, j,
+		frameTime);
+}
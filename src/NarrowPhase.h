@@ -0,0 +1,43 @@
+/*
+* Overlap tests between one ball and a range of other balls.
+*
+* findOverlaps compares squared center distances against squared radius sums,
+* so it needs no square roots and no temporaries, and it tests 8 (AVX2) or
+* 4 (SSE) candidates per instruction. The kernel is chosen once at runtime
+* from the features of the CPU; on other architectures, or when no vector
+* unit is available, a scalar loop is used.
+*
+* Only the pairs reported here need to go through the full collision
+* resolution, collide(), which the fixed stepper of World calls for each of
+* them.
+*/
+
+#ifndef NARROW_PHASE_H
+#define NARROW_PHASE_H
+
+#include "BallSystem.h"
+#include "Vec.h"
+
+enum OverlapKernel
+{
+	OVERLAP_AUTO,
+	OVERLAP_SCALAR,
+	OVERLAP_SSE,
+	OVERLAP_AVX2
+};
+
+int findOverlaps(const BallSystem &balls, int i, int begin, int end, int *hits);
+
+bool setOverlapKernel(OverlapKernel kernel);
+const char *overlapKernelName();
+
+real collisionPoint(float *x, float *y, const float *vx, const float *vy,
+					int i, int j, real frameTime, real distanceAtFrameEnd,
+					real collisionDistance);
+real collisionPoint(BallSystem &balls, int i, int j, real frameTime,
+					real distanceAtFrameEnd, real collisionDistance);
+void collide(float *x, float *y, float *vx, float *vy, const float *radius,
+			int i, int j, real frameTime);
+void collide(BallSystem &balls, int i, int j, real frameTime);
+
+#endif
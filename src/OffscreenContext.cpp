@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+#include "OffscreenContext.h"
+
+#ifdef BILLIARD_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+/*
+* The surfaceless display of Mesa if the client library offers it, else the
+* default display.
+*/
+static EGLDisplay openDisplay()
+{
+	const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+	if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)
+			eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		if (getPlatformDisplay)
+		{
+			EGLDisplay display = getPlatformDisplay(
+				EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+			if (display != EGL_NO_DISPLAY)
+				return display;
+		}
+	}
+
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+#endif
+
+OffscreenContext::OffscreenContext()
+	: display(0), context(0), surface(0)
+{
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	destroy();
+}
+
+/*
+* Create a desktop OpenGL context drawing into a width x height RGB buffer
+* and make it current. Returns false, and prints why to stderr, if that fails.
+*/
+bool OffscreenContext::create(int width, int height)
+{
+	destroy();
+
+#ifdef BILLIARD_EGL
+	EGLDisplay eglDisplay = openDisplay();
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, 0, 0))
+	{
+		fprintf(stderr, "offscreen: no EGL display\n");
+		return false;
+	}
+	display = eglDisplay;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		fprintf(stderr, "offscreen: EGL has no desktop OpenGL\n");
+		destroy();
+		return false;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numOfConfigs = 0;
+	if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1,
+		&numOfConfigs) || numOfConfigs < 1)
+	{
+		fprintf(stderr, "offscreen: no EGL config for an RGB pbuffer\n");
+		destroy();
+		return false;
+	}
+
+	const EGLint surfaceAttributes[] = {
+		EGL_WIDTH, width,
+		EGL_HEIGHT, height,
+		EGL_NONE
+	};
+	context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, 0);
+	if (context != EGL_NO_CONTEXT)
+	{
+		surface = eglCreatePbufferSurface(eglDisplay, config,
+			surfaceAttributes);
+	}
+
+	if (context == EGL_NO_CONTEXT || surface == EGL_NO_SURFACE ||
+		!eglMakeCurrent(eglDisplay, surface, surface, context))
+	{
+		fprintf(stderr, "offscreen: cannot create an EGL context (0x%x)\n",
+			eglGetError());
+		destroy();
+		return false;
+	}
+
+	return true;
+#else
+	fprintf(stderr, "offscreen: built without EGL\n");
+	return false;
+#endif
+}
+
+void OffscreenContext::destroy()
+{
+#ifdef BILLIARD_EGL
+	if (display)
+	{
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			EGL_NO_CONTEXT);
+		if (surface)
+		{
+			eglDestroySurface(display, surface);
+		}
+		if (context)
+		{
+			eglDestroyContext(display, context);
+		}
+		eglTerminate(display);
+	}
+#endif
+
+	display = context = surface = 0;
+}
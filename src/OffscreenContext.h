@@ -0,0 +1,39 @@
+/*
+* An OpenGL context without a window, for rendering on a machine without a
+* display.
+*
+* The context is created through EGL on the surfaceless platform of Mesa
+* (EGL_MESA_platform_surfaceless), which needs neither an X server nor a GPU:
+* with llvmpipe everything is rendered on the CPU. Where that platform is
+* missing the default EGL display is tried. The context draws into a pbuffer
+* of the given size, so framebuffer 0 behaves as the back buffer of a window
+* would and the usual drawing code runs unchanged.
+*
+* Only available when the viewer is built with EGL (BILLIARD_EGL); otherwise
+* create() always fails.
+*/
+
+#ifndef OFFSCREEN_CONTEXT_H
+#define OFFSCREEN_CONTEXT_H
+
+class OffscreenContext
+{
+	public:
+		OffscreenContext();
+		~OffscreenContext();
+
+		bool create(int width, int height);
+		void destroy();
+
+	private:
+		OffscreenContext(const OffscreenContext &);
+		OffscreenContext &operator=(const OffscreenContext &);
+
+		// EGLDisplay, EGLContext and EGLSurface, kept opaque so that this
+		// header does not need EGL
+		void *display;
+		void *context;
+		void *surface;
+};
+
+#endif
@@ -0,0 +1,466 @@
+#include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Replay.h"
+
+static const char replay_magic[4] = {'B', 'R', 'P', 'L'};
+static const uint32_t replay_version = 2;
+
+/*****************************************************************************
+							ReplayWriter
+******************************************************************************/
+
+ReplayWriter::ReplayWriter() : file(0), stepTime(frame_time), failed(false)
+{
+	memset(&header, 0, sizeof(header));
+}
+
+ReplayWriter::~ReplayWriter()
+{
+	close();
+}
+
+/*
+* Start recording into the file at path, which is overwritten. The world
+* must be stepped with step() from now on, each step stepTime seconds long.
+* Returns false if the file could not be created.
+*/
+bool ReplayWriter::open(const char *path, World &world, float stepTime,
+						int keyframeInterval)
+{
+	close();
+
+	file = fopen(path, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, replay_magic, sizeof(replay_magic));
+	header.version = replay_version;
+	header.tableLength = world.getTable().length;
+	header.stepTime = stepTime;
+	header.numOfBalls = world.numOfBalls();
+	header.broadPhase = world.broadPhaseType();
+	header.keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 1;
+
+	this->stepTime = stepTime;
+	failed = false;
+	inputs.clear();
+	index.clear();
+
+	// the real header is written by close()
+	failed |= fwrite(&header, sizeof(header), 1, file) != 1;
+
+	world.restartPrediction();
+	failed |= !writeKeyframe(world);
+
+	return !failed;
+}
+
+/*
+* Write the inputs, the keyframe index and the header and close the file.
+* Returns false if anything could not be written.
+*/
+bool ReplayWriter::close()
+{
+	if (!file)
+	{
+		return false;
+	}
+
+	header.inputsOffset = ftell(file);
+	header.numOfInputs = (int32_t) inputs.size();
+	if (!inputs.empty())
+	{
+		failed |= fwrite(&inputs[0], sizeof(ReplayInput), inputs.size(),
+						file) != inputs.size();
+	}
+
+	// align the index for the reader
+	static const char zeros[8] = {0};
+	long padding = (8 - ftell(file) % 8) % 8;
+	failed |= fwrite(zeros, 1, padding, file) != (size_t) padding;
+
+	header.indexOffset = ftell(file);
+	header.numOfKeyframes = (int32_t) index.size();
+	failed |= fwrite(&index[0], sizeof(uint64_t), index.size(), file) !=
+		index.size();
+
+	failed |= fseek(file, 0, SEEK_SET) != 0;
+	failed |= fwrite(&header, sizeof(header), 1, file) != 1;
+	failed |= fclose(file) != 0;
+	file = 0;
+
+	return !failed;
+}
+
+bool ReplayWriter::isOpen() const
+{
+	return file != 0;
+}
+
+/*
+* Number of steps recorded so far.
+*/
+int ReplayWriter::frame() const
+{
+	return header.numOfFrames;
+}
+
+void ReplayWriter::shoot(World &world, float angle, float power)
+{
+	addInput(REPLAY_SHOT, 0, angle, power);
+	world.shoot(angle, power);
+}
+
+void ReplayWriter::reset(World &world, int numOfBalls)
+{
+	addInput(REPLAY_RESET, numOfBalls, 0.0f, 0.0f);
+	world.setup(numOfBalls);
+}
+
+void ReplayWriter::setEngine(World &world, EngineType type)
+{
+	addInput(REPLAY_ENGINE, type, 0.0f, 0.0f);
+	world.setEngine(type);
+}
+
+/*
+* Switch the motion model, see World::setMotion(). Nothing is recorded if
+* the world refuses it.
+*/
+bool ReplayWriter::setMotion(World &world, MotionModel model)
+{
+	if (!world.setMotion(model))
+	{
+		return false;
+	}
+
+	addInput(REPLAY_MOTION, model, 0.0f, 0.0f);
+	return true;
+}
+
+/*
+* Advance the world by one step and record a keyframe when one is due.
+* Returns the number of balls that fell into a pocket.
+*/
+int ReplayWriter::step(World &world)
+{
+	int pocketed = world.step(stepTime);
+
+	if (file)
+	{
+		header.numOfFrames++;
+		if (header.numOfFrames % header.keyframeInterval == 0)
+		{
+			// a seek restores the keyframe and predicts from there, so the
+			// live game has to do the same to stay identical
+			world.restartPrediction();
+			failed |= !writeKeyframe(world);
+		}
+	}
+
+	return pocketed;
+}
+
+void ReplayWriter::addInput(ReplayInputType type, int value, float angle,
+							float power)
+{
+	if (!file)
+	{
+		return;
+	}
+
+	ReplayInput input;
+	input.frame = header.numOfFrames;
+	input.type = type;
+	input.value = value;
+	input.angle = angle;
+	input.power = power;
+	inputs.push_back(input);
+}
+
+bool ReplayWriter::writeKeyframe(const World &world)
+{
+	const BallSystem &balls = world.getBalls();
+	const int n = balls.size();
+
+	ReplayKeyframe keyframe;
+	keyframe.frame = header.numOfFrames;
+	keyframe.numOfBalls = n;
+	keyframe.engine = world.engineType();
+	keyframe.motion = world.motionModel();
+	keyframe.scratched = world.cueBallScratched();
+
+	// balls are stored in their current order, which the broad phase
+	// depends on
+	scratch.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		ReplayBall &ball = scratch[i];
+		ball.x = balls.x[i];
+		ball.y = balls.y[i];
+		ball.vx = balls.vx[i];
+		ball.vy = balls.vy[i];
+		ball.wx = balls.wx[i];
+		ball.wy = balls.wy[i];
+		ball.radius = balls.radius[i];
+		ball.id = balls.id[i];
+		ball.active = balls.active[i];
+		ball.material = balls.material[i];
+		ball.padding[0] = ball.padding[1] = 0;
+	}
+
+	index.push_back(ftell(file));
+
+	bool written = fwrite(&keyframe, sizeof(keyframe), 1, file) == 1;
+	if (n > 0)
+	{
+		written &= fwrite(&scratch[0], sizeof(ReplayBall), n, file) ==
+			(size_t) n;
+	}
+
+	return written;
+}
+
+/*****************************************************************************
+							ReplayReader
+******************************************************************************/
+
+ReplayReader::ReplayReader()
+	: data(0), size(0), header(0), inputs(0), index(0)
+{
+}
+
+ReplayReader::~ReplayReader()
+{
+	close();
+}
+
+/*
+* Map the replay file at path. Returns false if it cannot be read or is not
+* a replay file.
+*/
+bool ReplayReader::open(const char *path)
+{
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size < (off_t) sizeof(ReplayHeader))
+	{
+		::close(fd);
+		return false;
+	}
+
+	void *mapped = mmap(0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED)
+	{
+		return false;
+	}
+
+	data = (const char *) mapped;
+	size = status.st_size;
+
+	const ReplayHeader *h = (const ReplayHeader *) data;
+	bool valid = memcmp(h->magic, replay_magic, sizeof(replay_magic)) == 0 &&
+		h->version == replay_version &&
+		h->keyframeInterval > 0 && h->numOfFrames >= 0 &&
+		h->numOfInputs >= 0 && h->numOfKeyframes > 0 &&
+		h->inputsOffset % sizeof(int32_t) == 0 &&
+		h->inputsOffset <= size &&
+		(size - h->inputsOffset) / sizeof(ReplayInput) >= (size_t) h->numOfInputs &&
+		h->indexOffset % sizeof(uint64_t) == 0 &&
+		h->indexOffset <= size &&
+		(size - h->indexOffset) / sizeof(uint64_t) >= (size_t) h->numOfKeyframes;
+
+	if (!valid)
+	{
+		close();
+		return false;
+	}
+
+	header = h;
+	inputs = (const ReplayInput *) (data + h->inputsOffset);
+	index = (const uint64_t *) (data + h->indexOffset);
+	return true;
+}
+
+void ReplayReader::close()
+{
+	if (data)
+	{
+		munmap((void *) data, size);
+	}
+
+	data = 0;
+	size = 0;
+	header = 0;
+	inputs = 0;
+	index = 0;
+}
+
+bool ReplayReader::isOpen() const
+{
+	return header != 0;
+}
+
+int ReplayReader::numOfFrames() const
+{
+	return header ? header->numOfFrames : 0;
+}
+
+float ReplayReader::stepTime() const
+{
+	return header ? header->stepTime : frame_time;
+}
+
+int ReplayReader::numOfInputs() const
+{
+	return header ? header->numOfInputs : 0;
+}
+
+const ReplayInput &ReplayReader::input(int i) const
+{
+	return inputs[i];
+}
+
+/*
+* Keyframe k, or null if the index points outside the file.
+*/
+const ReplayKeyframe *ReplayReader::keyframe(int k) const
+{
+	uint64_t offset = index[k];
+
+	if (offset % sizeof(int32_t) != 0 || offset > size ||
+		size - offset < sizeof(ReplayKeyframe))
+	{
+		return 0;
+	}
+
+	const ReplayKeyframe *keyframe = (const ReplayKeyframe *) (data + offset);
+	size_t left = size - offset - sizeof(ReplayKeyframe);
+
+	if (keyframe->numOfBalls < 0 ||
+		left / sizeof(ReplayBall) < (size_t) keyframe->numOfBalls)
+	{
+		return 0;
+	}
+
+	return keyframe;
+}
+
+/*
+* Put the world into the state it had before the given step, i.e. after
+* frame steps. Frames past the end go to the end. Returns false if the
+* file is damaged.
+*/
+bool ReplayReader::seek(World &world, int frame) const
+{
+	if (!header)
+	{
+		return false;
+	}
+
+	frame = std::max(0, std::min(frame, header->numOfFrames));
+
+	int k = std::min(frame / header->keyframeInterval,
+					header->numOfKeyframes - 1);
+	const ReplayKeyframe *key = keyframe(k);
+	if (!key || key->frame > frame)
+	{
+		return false;
+	}
+
+	world = World(header->tableLength);
+	world.setBroadPhase((BroadPhaseType) header->broadPhase);
+	world.setEngine((EngineType) key->engine);
+	world.setMotion((MotionModel) key->motion);
+	world.setup(key->numOfBalls);
+
+	BallSystem state = world.getBalls();
+	const ReplayBall *balls = (const ReplayBall *) (key + 1);
+	for (int i = 0; i < key->numOfBalls; i++)
+	{
+		state.x[i] = state.lastX[i] = balls[i].x;
+		state.y[i] = state.lastY[i] = balls[i].y;
+		state.vx[i] = balls[i].vx;
+		state.vy[i] = balls[i].vy;
+		state.wx[i] = balls[i].wx;
+		state.wy[i] = balls[i].wy;
+		state.radius[i] = balls[i].radius;
+		state.id[i] = balls[i].id;
+		state.active[i] = balls[i].active;
+		state.material[i] = balls[i].material;
+	}
+	world.restoreBalls(state, key->scratched != 0);
+
+	for (int f = key->frame; f < frame; f++)
+	{
+		step(world, f);
+	}
+
+	return true;
+}
+
+/*
+* Apply the inputs made before the given step and take the step. The world
+* must be in the state it had after frame steps. Returns the number of balls
+* that fell into a pocket.
+*/
+int ReplayReader::step(World &world, int frame) const
+{
+	if (!header)
+	{
+		return 0;
+	}
+
+	ReplayInput key;
+	key.frame = frame;
+	const ReplayInput *end = inputs + header->numOfInputs;
+	const ReplayInput *input = std::lower_bound(inputs, end, key,
+		[](const ReplayInput &lhs, const ReplayInput &rhs)
+		{
+			return lhs.frame < rhs.frame;
+		});
+
+	for (; input != end && input->frame == frame; input++)
+	{
+		switch (input->type)
+		{
+			case REPLAY_SHOT:
+				world.shoot(input->angle, input->power);
+				break;
+			case REPLAY_RESET:
+				world.setup(input->value);
+				break;
+			case REPLAY_ENGINE:
+				world.setEngine((EngineType) input->value);
+				break;
+			case REPLAY_MOTION:
+				world.setMotion((MotionModel) input->value);
+				break;
+		}
+	}
+
+	int pocketed = world.step(header->stepTime);
+
+	// as the writer did, so a seek and playing on agree exactly
+	if ((frame + 1) % header->keyframeInterval == 0)
+	{
+		world.restartPrediction();
+	}
+
+	return pocketed;
+}
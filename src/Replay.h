@@ -0,0 +1,170 @@
+/*
+* Recording and replaying games.
+*
+* A replay file holds everything needed to play a game again exactly: a
+* header with the table and the simulation settings, the inputs (shots,
+* resets, engine and motion model switches) with the step at which they were
+* made, and a
+* full copy of the ball state every keyframe_interval steps. An index at the
+* end of the file gives the offset of every keyframe.
+*
+* The simulation is deterministic, so the inputs alone would be enough; the
+* keyframes make seeking cheap. ReplayReader maps the file into memory and
+* reaches any step by restoring the keyframe before it and simulating at most
+* keyframe_interval - 1 steps, however long the game is. Nothing but the
+* header is read when the file is opened.
+*
+* All fields are stored in the byte order of the machine that wrote them.
+*
+* File layout:
+*	ReplayHeader
+*	keyframes: ReplayKeyframe followed by numOfBalls ReplayBall each
+*	inputs: numOfInputs ReplayInput, ordered by step
+*	index: numOfKeyframes 64 bit file offsets, keyframe k is at step
+*		k * keyframeInterval
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "World.h"
+
+// a keyframe every 5 seconds of play
+const int replay_keyframe_interval = 5 * fps;
+
+enum ReplayInputType
+{
+	REPLAY_SHOT,
+	REPLAY_RESET,
+	REPLAY_ENGINE,
+	REPLAY_MOTION
+};
+
+struct ReplayHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t inputsOffset;
+	uint64_t indexOffset;
+	float tableLength;
+	float stepTime;
+	int32_t numOfBalls;
+	int32_t broadPhase;
+	int32_t keyframeInterval;
+	int32_t numOfFrames;
+	int32_t numOfInputs;
+	int32_t numOfKeyframes;
+};
+
+struct ReplayInput
+{
+	int32_t frame; // made before this step
+	int32_t type;
+	int32_t value; // number of balls for a reset, EngineType or MotionModel
+		// for a switch
+	float angle;
+	float power;
+};
+
+struct ReplayKeyframe
+{
+	int32_t frame;
+	int32_t numOfBalls;
+	int32_t engine;
+	int32_t motion;
+	int32_t scratched;
+};
+
+struct ReplayBall
+{
+	float x;
+	float y;
+	float vx;
+	float vy;
+	float wx; // the spin, only with MOTION_SLIDE_ROLL
+	float wy;
+	float radius;
+	int32_t id;
+	uint8_t active;
+	uint8_t material;
+	uint8_t padding[2];
+};
+
+/*
+* Records a game while it is played. Every change to the world goes through
+* the writer, which applies it and notes it down. When no file is open the
+* changes are still applied, so the caller can route all input through the
+* writer whether it records or not.
+*/
+class ReplayWriter
+{
+	public:
+		ReplayWriter();
+		~ReplayWriter();
+
+		bool open(const char *path, World &world, float stepTime,
+				int keyframeInterval = replay_keyframe_interval);
+		bool close();
+		bool isOpen() const;
+		int frame() const;
+
+		void shoot(World &world, float angle, float power);
+		void reset(World &world, int numOfBalls = NUM_OF_BALLS);
+		void setEngine(World &world, EngineType type);
+		bool setMotion(World &world, MotionModel model);
+		int step(World &world);
+
+	private:
+		ReplayWriter(const ReplayWriter &);
+		ReplayWriter &operator=(const ReplayWriter &);
+
+		void addInput(ReplayInputType type, int value, float angle, float power);
+		bool writeKeyframe(const World &world);
+
+		FILE *file;
+		ReplayHeader header;
+		std::vector<ReplayInput> inputs;
+		std::vector<uint64_t> index;
+		std::vector<ReplayBall> scratch;
+		float stepTime;
+		bool failed;
+};
+
+/*
+* Plays a recorded game back from a memory mapped replay file.
+*/
+class ReplayReader
+{
+	public:
+		ReplayReader();
+		~ReplayReader();
+
+		bool open(const char *path);
+		void close();
+		bool isOpen() const;
+
+		int numOfFrames() const;
+		float stepTime() const;
+		int numOfInputs() const;
+		const ReplayInput &input(int i) const;
+
+		bool seek(World &world, int frame) const;
+		int step(World &world, int frame) const;
+
+	private:
+		ReplayReader(const ReplayReader &);
+		ReplayReader &operator=(const ReplayReader &);
+
+		const ReplayKeyframe *keyframe(int k) const;
+
+		const char *data;
+		size_t size;
+		const ReplayHeader *header;
+		const ReplayInput *inputs;
+		const uint64_t *index;
+};
+
+#endif
@@ -0,0 +1,155 @@
+/*
+* A bounded queue that any number of threads push to and pop from without
+* taking a lock.
+*
+* The queue is a ring of cells, each with a sequence number that says whose
+* turn it is: a pusher may fill cell i when its sequence is i, a popper may
+* empty it when its sequence is i + 1. Claiming a cell is one compare and
+* swap on the head or the tail; after that the owner copies its value in or
+* out and publishes the new sequence, so a slow thread only ever holds up
+* the one cell it claimed. push() and pop() return false instead of waiting
+* when the queue is full or empty.
+*
+* The head and the tail live on cache lines of their own, so the producers
+* and the consumer do not slow each other down through false sharing.
+*/
+
+#ifndef RESULT_QUEUE_H
+#define RESULT_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+template <class T>
+class ResultQueue
+{
+	public:
+		ResultQueue(int capacity = 1024);
+		~ResultQueue();
+
+		bool push(const T &value);
+		bool pop(T &value);
+		int capacity() const;
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		ResultQueue(const ResultQueue &);
+		ResultQueue &operator=(const ResultQueue &);
+
+		Cell *cells;
+		size_t mask;
+
+		alignas(64) std::atomic<size_t> tail; // next cell to push
+		alignas(64) std::atomic<size_t> head; // next cell to pop
+};
+
+/*
+* The capacity is rounded up to a power of two.
+*/
+template <class T>
+ResultQueue<T>::ResultQueue(int capacity)
+	: tail(0), head(0)
+{
+	size_t size = 2;
+	while (size < (size_t) capacity)
+	{
+		size *= 2;
+	}
+
+	cells = new Cell[size];
+	mask = size - 1;
+	for (size_t i = 0; i < size; i++)
+	{
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+template <class T>
+ResultQueue<T>::~ResultQueue()
+{
+	delete[] cells;
+}
+
+template <class T>
+int ResultQueue<T>::capacity() const
+{
+	return (int) (mask + 1);
+}
+
+/*
+* Append a copy of value. Returns false if the queue is full.
+*/
+template <class T>
+bool ResultQueue<T>::push(const T &value)
+{
+	size_t position = tail.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		Cell &cell = cells[position & mask];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		ptrdiff_t lag = (ptrdiff_t) sequence - (ptrdiff_t) position;
+
+		if (lag == 0)
+		{
+			if (tail.compare_exchange_weak(position, position + 1,
+				std::memory_order_relaxed))
+			{
+				cell.value = value;
+				cell.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (lag < 0)
+		{
+			return false;
+		}
+		else
+		{
+			position = tail.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+/*
+* Take the oldest value. Returns false if the queue is empty.
+*/
+template <class T>
+bool ResultQueue<T>::pop(T &value)
+{
+	size_t position = head.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		Cell &cell = cells[position & mask];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		ptrdiff_t lag = (ptrdiff_t) sequence - (ptrdiff_t) (position + 1);
+
+		if (lag == 0)
+		{
+			if (head.compare_exchange_weak(position, position + 1,
+				std::memory_order_relaxed))
+			{
+				value = cell.value;
+				cell.sequence.store(position + mask + 1,
+					std::memory_order_release);
+				return true;
+			}
+		}
+		else if (lag < 0)
+		{
+			return false;
+		}
+		else
+		{
+			position = head.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+#endif
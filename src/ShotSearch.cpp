@@ -0,0 +1,217 @@
+#include <atomic>
+#include <mutex>
+#include "FrameScheduler.h"
+#include "ShotSearch.h"
+#include "Trace.h"
+
+ShotSearchOptions::ShotSearchOptions()
+	: candidates(1024), seed(1), timeBudget(0.0), engine(ENGINE_EVENT_DRIVEN),
+	timeStep(frame_time), maxSteps(100000), scratchPenalty(1.0f), batchSize(16)
+{
+}
+
+/*
+* Mix the seed and the index into a well spread 64 bit value (splitmix64).
+*/
+static unsigned long long mix(unsigned long long value)
+{
+	value += 0x9e3779b97f4a7c15ULL;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+	return value ^ (value >> 31);
+}
+
+/*
+* The shot tried as the given candidate: any angle, and a power between 5%
+* and 100%.
+*/
+Shot candidateShot(unsigned int seed, int candidate)
+{
+	unsigned long long bits = mix(((unsigned long long) seed << 32) | candidate);
+	Shot shot;
+
+	shot.angle = (bits & 0xffffff) / (float) 0x1000000 * 360.0f;
+	shot.power = 0.05f + 0.95f * ((bits >> 24) & 0xffffff) / (float) 0x1000000;
+	return shot;
+}
+
+static int ballsOnTable(const World &world)
+{
+	int count = 0;
+	for (int i = 0; i < world.numOfBalls(); i++)
+	{
+		count += world.isBallVisible(i);
+	}
+
+	return count;
+}
+
+/*
+* Play the shot out to rest on the given world, which is changed, and score
+* it. before is the number of balls that were on the table.
+*/
+static ShotResult playShot(World &world, const Shot &shot,
+						const ShotSearchOptions &options, int before)
+{
+	world.shoot(shot.angle, shot.power);
+	world.runUntilRest(options.timeStep, options.maxSteps);
+
+	int after = ballsOnTable(world);
+
+	ShotResult result;
+	result.shot = shot;
+	result.candidate = -1;
+	result.pocketed = before - after;
+	result.scratched = world.cueBallScratched();
+	result.score = result.pocketed - (result.scratched ? options.scratchPenalty : 0.0f);
+	result.evaluated = 1;
+	return result;
+}
+
+/*
+* Play the shot out to rest on a copy of the world and score it.
+*/
+ShotResult evaluateShot(const World &world, const Shot &shot,
+						const ShotSearchOptions &options)
+{
+	World copy = world;
+	copy.setEngine(options.engine);
+	return playShot(copy, shot, options, ballsOnTable(copy));
+}
+
+/*
+* Whether a is a better result than b. Unset results (candidate -1) lose,
+* equal scores go to the lower candidate.
+*/
+static bool better(const ShotResult &a, const ShotResult &b)
+{
+	if (a.candidate < 0)
+		return false;
+	if (b.candidate < 0)
+		return true;
+	if (a.score != b.score)
+		return a.score > b.score;
+	return a.candidate < b.candidate;
+}
+
+/*
+* State shared by all tasks of one search.
+*/
+struct SearchContext
+{
+	ThreadPool *pool;
+	const World *world;
+	const ShotSearchOptions *options;
+	WorldSnapshot start;
+	int before;
+	long long deadline;
+	std::mutex lock;
+	ShotResult best;
+	std::atomic<int> evaluated;
+};
+
+static bool pastDeadline(const SearchContext &context)
+{
+	return context.options->timeBudget > 0.0 &&
+		monotonicNanoseconds() > context.deadline;
+}
+
+/*
+* Search the candidates in [begin, end). Ranges larger than one batch are
+* halved and the upper half is handed back to the pool, where an idle worker
+* can steal it. Splitting only as the work is taken keeps the number of
+* queued tasks small, however many candidates there are.
+*/
+static void searchRange(SearchContext *context, int begin, int end)
+{
+	const int batchSize = context->options->batchSize > 0 ?
+		context->options->batchSize : 1;
+
+	while (end - begin > batchSize)
+	{
+		if (pastDeadline(*context))
+		{
+			return;
+		}
+
+		int middle = begin + (end - begin) / 2;
+		context->pool->submit([context, middle, end]()
+		{
+			searchRange(context, middle, end);
+		});
+		end = middle;
+	}
+
+	TRACE_ZONE("shot batch");
+
+	ShotResult best;
+	best.candidate = -1;
+
+	// one world per batch, put back to the start before every shot
+	World world = *context->world;
+
+	for (int i = begin; i < end; i++)
+	{
+		if (pastDeadline(*context))
+		{
+			break;
+		}
+
+		world.restore(context->start);
+		ShotResult result = playShot(world,
+			candidateShot(context->options->seed, i), *context->options,
+			context->before);
+		result.candidate = i;
+		context->evaluated++;
+
+		if (better(result, best))
+		{
+			best = result;
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(context->lock);
+	if (better(best, context->best))
+	{
+		context->best = best;
+	}
+}
+
+/*
+* Evaluate options.candidates shots from the given world on the pool and
+* return the best one. If no candidate was evaluated before the time budget
+* ran out, the result has candidate -1. Must not be called from a task
+* running on the same pool.
+*/
+ShotResult findBestShot(ThreadPool &pool, const World &world,
+						const ShotSearchOptions &options)
+{
+	SearchContext context;
+	context.pool = &pool;
+	context.world = &world;
+	context.options = &options;
+
+	World start = world;
+	start.setEngine(options.engine);
+	start.snapshot(context.start);
+	context.before = ballsOnTable(start);
+
+	context.deadline = monotonicNanoseconds() +
+		(long long) (options.timeBudget * 1e9);
+	context.best.candidate = -1;
+	context.best.pocketed = 0;
+	context.best.scratched = false;
+	context.best.score = 0.0f;
+	context.evaluated = 0;
+
+	const int candidates = options.candidates;
+	pool.submit([&context, candidates]()
+	{
+		searchRange(&context, 0, candidates);
+	});
+	pool.wait();
+
+	ShotResult result = context.best;
+	result.evaluated = context.evaluated;
+	return result;
+}
@@ -0,0 +1,59 @@
+/*
+* Monte Carlo search for a good shot from the current table.
+*
+* Candidate shots (angle, power) are drawn at random, each one is played out
+* to rest on its own copy of the World and scored by the number of object
+* balls it pockets, minus a penalty if the cue ball scratches. The candidates
+* are split into batches that run on a ThreadPool; how long a shot takes
+* varies a lot, and work stealing evens that out.
+*
+* Candidate i always gets the same shot for the same seed, and ties are
+* broken by the candidate index, so the result does not depend on the number
+* of threads. With a time budget the search is an anytime search: candidates
+* not reached when the budget runs out are skipped and the best shot found so
+* far is returned.
+*/
+
+#ifndef SHOT_SEARCH_H
+#define SHOT_SEARCH_H
+
+#include "ThreadPool.h"
+#include "World.h"
+
+struct Shot
+{
+	float angle;
+	float power;
+};
+
+struct ShotResult
+{
+	Shot shot;
+	int candidate;
+	int pocketed;
+	bool scratched;
+	float score;
+	int evaluated;
+};
+
+struct ShotSearchOptions
+{
+	ShotSearchOptions();
+
+	int candidates;
+	unsigned int seed;
+	double timeBudget; // seconds, 0 for no limit
+	EngineType engine;
+	float timeStep;
+	int maxSteps;
+	float scratchPenalty;
+	int batchSize;
+};
+
+Shot candidateShot(unsigned int seed, int candidate);
+ShotResult evaluateShot(const World &world, const Shot &shot,
+						const ShotSearchOptions &options);
+ShotResult findBestShot(ThreadPool &pool, const World &world,
+						const ShotSearchOptions &options);
+
+#endif
@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <chrono>
+#include "ShotSearch.h"
+#include "SimulationThread.h"
+#include "Trace.h"
+
+// commands waiting for the next step; input never comes close
+const int command_queue_size = 64;
+
+TableFrame::TableFrame()
+	: time(0), stepLength(1), cueBallAngle(90), cueBallPower(0.0f)
+#ifdef BILLIARD_STATS
+	, physicsTime(0), counters()
+#endif
+{
+}
+
+/*
+* Copy the balls that are still on the table and the pockets of world. The
+* vectors keep their memory, so this only allocates while they grow.
+*/
+void TableFrame::capture(const World &world)
+{
+	const BallSystem &balls = world.getBalls();
+
+	x.clear();
+	y.clear();
+	lastX.clear();
+	lastY.clear();
+	id.clear();
+	for (int i = 0; i < balls.size(); i++)
+	{
+		if (!world.isBallVisible(i))
+		{
+			continue;
+		}
+
+		x.push_back(balls.x[i]);
+		y.push_back(balls.y[i]);
+		lastX.push_back(balls.lastX[i]);
+		lastY.push_back(balls.lastY[i]);
+		id.push_back(balls.id[i]);
+	}
+
+	pockets.clear();
+	for (int i = 0; i < world.numOfPockets(); i++)
+	{
+		pockets.push_back(world.pocket(i));
+	}
+}
+
+/*
+* Whether the balls did not move in the last step, so the picture no longer
+* depends on the interpolation.
+*/
+bool TableFrame::isStill() const
+{
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		if (x[i] != lastX[i] || y[i] != lastY[i])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+* How far the real time now is into the step after the last one, between 0
+* and 1: where to draw the balls between lastX and x.
+*/
+float TableFrame::alpha(long long now) const
+{
+	float alpha = (float) (now - time) / stepLength;
+	return alpha < 0.0f ? 0.0f : alpha > 1.0f ? 1.0f : alpha;
+}
+
+SimulationCommand::SimulationCommand(SimulationCommandType type)
+	: type(type), angle(0), power(0.0f), seconds(0.0f)
+{
+}
+
+SimulationThread::SimulationThread(float stepTime)
+	: scheduler(stepTime), replayFrame(0), canUndo(false), cueBallAngle(90),
+	cueBallPower(0.0f), commands(command_queue_size), publishedStill(false),
+#ifdef BILLIARD_STATS
+	physicsTime(0), counters(),
+#endif
+	running(false)
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+/*
+* Rack the balls. Before start() only; afterwards send COMMAND_RESET.
+*/
+void SimulationThread::setup()
+{
+	recorder.reset(world);
+	canUndo = false;
+}
+
+/*
+* Record the game from now on into the file at path. Before start() only.
+*/
+bool SimulationThread::startRecording(const char *path)
+{
+	if (!recorder.open(path, world, scheduler.stepTime()))
+	{
+		printf("cannot record to %s\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+* Play the game recorded in the file at path instead of taking input.
+* Before start() only.
+*/
+bool SimulationThread::startReplay(const char *path)
+{
+	if (!replay.open(path) || !replay.seek(world, 0))
+	{
+		printf("cannot replay %s\n", path);
+		replay.close();
+		return false;
+	}
+
+	replayFrame = 0;
+	printf("replaying %d frames\n", replay.numOfFrames());
+	return true;
+}
+
+/*
+* Publish the table as it is and start stepping it on the thread. Returns
+* right away.
+*/
+void SimulationThread::start()
+{
+	if (thread.joinable())
+	{
+		return;
+	}
+
+	scheduler.reset();
+	publish(monotonicNanoseconds());
+	running = true;
+	thread = std::thread(&SimulationThread::run, this);
+}
+
+/*
+* Stop stepping and wait for the thread. Commands not yet taken are
+* dropped. The last frame published can still be taken.
+*/
+void SimulationThread::stop()
+{
+	running = false;
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+bool SimulationThread::isRunning() const
+{
+	return running;
+}
+
+/*
+* Queue a command for the thread, which applies it before its next step.
+* Returns false if the queue is full and the command was dropped.
+*/
+bool SimulationThread::send(const SimulationCommand &command)
+{
+	return commands.push(command);
+}
+
+/*
+* Take the newest frame published, if there is one the caller has not seen.
+* Returns whether frame() changed.
+*/
+bool SimulationThread::takeFrame()
+{
+	return frames.update();
+}
+
+/*
+* The frame taken by the last takeFrame(). Only for the thread that takes
+* them.
+*/
+const TableFrame &SimulationThread::frame() const
+{
+	return frames.front();
+}
+
+/*
+* The loop of the thread: apply the commands, take the steps that are due,
+* publish the table if the picture changed and sleep until the next step.
+*/
+void SimulationThread::run()
+{
+	setTraceThreadName("simulation");
+
+	const long long step_length =
+		(long long) (scheduler.stepTime() * 1e9 + 0.5);
+
+	while (running)
+	{
+		long long now = monotonicNanoseconds();
+		bool changed = false;
+
+		SimulationCommand command;
+		while (commands.pop(command))
+		{
+			apply(command);
+			changed = true;
+		}
+
+		int steps = scheduler.frame(now);
+		for (int i = 0; i < steps; i++)
+		{
+			changed |= step();
+		}
+
+		long long sinceStep = (long long) (scheduler.alpha() * step_length);
+		// the frame after the balls stopped is still needed, for the picture
+		// without interpolation
+		if (changed || (steps > 0 && !publishedStill))
+		{
+			publish(now - sinceStep);
+		}
+
+		std::this_thread::sleep_for(
+			std::chrono::nanoseconds(step_length - sinceStep));
+	}
+}
+
+/*
+* Take one physics step, or play the next frame of the replay. Returns
+* whether any ball moved.
+*/
+bool SimulationThread::step()
+{
+	TRACE_ZONE("step");
+
+#ifdef BILLIARD_STATS
+	long long start = monotonicNanoseconds();
+#endif
+
+	if (replay.isOpen())
+	{
+		if (replayFrame < replay.numOfFrames())
+			replay.step(world, replayFrame++);
+	}
+	else
+	{
+		recorder.step(world);
+	}
+
+#ifdef BILLIARD_STATS
+	physicsTime += monotonicNanoseconds() - start;
+
+	// the counters of this thread, see Stats.h
+	PhysicsCounters &counted = physicsCounters();
+	counters.pairTests += counted.pairTests;
+	counters.collisions += counted.collisions;
+	counters.cushionHits += counted.cushionHits;
+	counters.pocketed += counted.pocketed;
+	counters.substeps += counted.substeps;
+	counted = PhysicsCounters();
+#endif
+
+	const BallSystem &balls = world.getBalls();
+	for (int i = 0; i < balls.size(); i++)
+	{
+		if (balls.x[i] != balls.lastX[i] || balls.y[i] != balls.lastY[i])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+* Hand the table to the drawing, with the last step due at stepDue.
+*/
+void SimulationThread::publish(long long stepDue)
+{
+	TRACE_ZONE("publish");
+
+	TableFrame &frame = frames.back();
+	frame.capture(world);
+	frame.time = stepDue;
+	frame.stepLength = (long long) (scheduler.stepTime() * 1e9 + 0.5);
+	frame.cueBallAngle = cueBallAngle;
+	frame.cueBallPower = cueBallPower;
+#ifdef BILLIARD_STATS
+	frame.physicsTime = physicsTime;
+	frame.counters = counters;
+#endif
+
+	publishedStill = frame.isStill();
+	frames.publish();
+}
+
+/*
+* Carry out one command of the drawing thread.
+*/
+void SimulationThread::apply(const SimulationCommand &command)
+{
+	// a replay only takes jumps
+	if (replay.isOpen() && command.type != COMMAND_SEEK)
+	{
+		return;
+	}
+
+	switch (command.type)
+	{
+		case COMMAND_AIM:
+			aim(command.angle, command.power);
+			break;
+		case COMMAND_SHOOT:
+			shoot();
+			break;
+		case COMMAND_RESET:
+			setup();
+			break;
+		case COMMAND_UNDO:
+			undo();
+			break;
+		case COMMAND_NEXT_ENGINE:
+			nextEngine();
+			break;
+		case COMMAND_FIND_SHOT:
+			findShot();
+			break;
+		case COMMAND_SEEK:
+			seekReplay(command.seconds);
+			break;
+	}
+}
+
+/*
+* Turn the cue and change the power, which stays between 0 and 1.
+*/
+void SimulationThread::aim(int angle, float power)
+{
+	cueBallPower += power;
+	if (cueBallPower > 1.0)
+		cueBallPower = 1.f;
+	if (cueBallPower < 0.0)
+		cueBallPower = 0;
+
+	cueBallAngle += angle;
+	if (cueBallAngle < 0)
+		cueBallAngle += 360;
+	if (cueBallAngle > 360)
+		cueBallAngle -= 360;
+}
+
+/*
+* Convert the angle and power into vectors and add to the cue ball.
+*/
+void SimulationThread::shoot()
+{
+	if (cueBallPower > 0.0)
+	{
+		/* Assume angle starts at the top of the y-axis
+		and goes clockwise around the quadrant.The angles
+		are decomposed into a pair of unit vectors that
+		points to the direction and are assigned to the
+		cue ball.*/
+
+		//DEBUG: max power
+		//cueBallPower = 1.0;
+
+		world.snapshot(beforeShot);
+		canUndo = true;
+		recorder.shoot(world, cueBallAngle, cueBallPower);
+
+		cueBallPower = 0; // reset the power
+	}
+}
+
+/*
+* Put the table back to how it was before the last shot. Not available while
+* recording, since the replay could not follow.
+*/
+void SimulationThread::undo()
+{
+	if (!canUndo || recorder.isOpen())
+		return;
+
+	world.restore(beforeShot);
+}
+
+/*
+* Switch to the next engine, in the order fixed step, adaptive step, event
+* driven.
+*/
+void SimulationThread::nextEngine()
+{
+	switch (world.engineType())
+	{
+		case ENGINE_FIXED_STEP:
+			recorder.setEngine(world, ENGINE_ADAPTIVE_STEP);
+			printf("engine: adaptive step\n");
+			break;
+		case ENGINE_ADAPTIVE_STEP:
+			recorder.setEngine(world, ENGINE_EVENT_DRIVEN);
+			printf("engine: event driven\n");
+			break;
+		case ENGINE_EVENT_DRIVEN:
+			recorder.setEngine(world, ENGINE_FIXED_STEP);
+			printf("engine: fixed step\n");
+			break;
+	}
+}
+
+/*
+* Search for a good shot for half a second and aim the cue there. The
+* drawing goes on meanwhile; the steps missed are dropped by the scheduler.
+*/
+void SimulationThread::findShot()
+{
+	if (world.isMoving())
+		return;
+
+	ShotSearchOptions options;
+	options.candidates = 1 << 20;
+	options.timeBudget = 0.5;
+
+	if (!pool)
+	{
+		pool.reset(new ThreadPool());
+	}
+
+	ShotResult best = findBestShot(*pool, world, options);
+	if (best.candidate < 0)
+		return;
+
+	cueBallAngle = (int) (best.shot.angle + 0.5f) % 360;
+	cueBallPower = best.shot.power;
+	printf("best of %d shots pockets %d%s\n", best.evaluated, best.pocketed,
+		best.scratched ? " but scratches" : "");
+}
+
+/*
+* Jump the replay by the given number of seconds.
+*/
+void SimulationThread::seekReplay(float seconds)
+{
+	if (!replay.isOpen())
+		return;
+
+	replayFrame += (int) (seconds / replay.stepTime());
+	replayFrame = replayFrame < 0 ? 0 : replayFrame;
+	replayFrame = replayFrame > replay.numOfFrames() ?
+		replay.numOfFrames() : replayFrame;
+
+	replay.seek(world, replayFrame);
+	printf("replay at %.1f s\n", replayFrame * replay.stepTime());
+}
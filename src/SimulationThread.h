@@ -0,0 +1,162 @@
+/*
+* Runs the game of the viewer on a thread of its own, so the physics keeps
+* its pace when a frame is slow to draw and the drawing does not wait for
+* the physics.
+*
+* The thread owns the world outright, with everything that changes it: the
+* recorder, the replay, the undo snapshot and the aim of the cue. It takes
+* fixed steps of stepTime as real time passes (see FrameScheduler.h) and
+* sleeps in between. The two threads share nothing else, and neither ever
+* waits for the other:
+*	- Input goes in as commands through a single producer, single
+*		consumer queue (see CommandQueue.h), which the thread drains
+*		before every step.
+*	- The balls come out as a TableFrame through a triple buffer (see
+*		TripleBuffer.h). The thread publishes one after every step that
+*		changed the picture, the drawing takes the newest one whenever it
+*		draws.
+*
+* A frame holds the balls after the last step and before it, and when that
+* step was due, so the drawing interpolates between them by the real time
+* that passed since (see TableFrame::alpha()), as the single threaded loop
+* did with FrameScheduler::alpha().
+*
+* setup(), startRecording() and startReplay() may only be called before
+* start(); after that, everything goes through send(), from one thread
+* only.
+*/
+
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "FrameScheduler.h"
+#include "CommandQueue.h"
+#include "Replay.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include "TripleBuffer.h"
+#include "World.h"
+
+/*
+* What the drawing needs of the table: the balls still on it, the pockets
+* and the aim of the cue.
+*/
+struct TableFrame
+{
+	TableFrame();
+
+	void capture(const World &world);
+	bool isStill() const;
+	float alpha(long long now) const;
+
+	// the balls on the table, after and before the last step
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> lastX;
+	std::vector<float> lastY;
+	std::vector<int> id;
+	std::vector<Pocket> pockets;
+
+	long long time; // when the last step was due, in monotonicNanoseconds()
+	long long stepLength; // in nanoseconds
+
+	int cueBallAngle;
+	float cueBallPower;
+
+#ifdef BILLIARD_STATS
+	// everything the thread did since it started
+	long long physicsTime;
+	PhysicsCounters counters;
+#endif
+};
+
+enum SimulationCommandType
+{
+	COMMAND_AIM, // turn the cue by angle degrees, add power
+	COMMAND_SHOOT,
+	COMMAND_RESET,
+	COMMAND_UNDO,
+	COMMAND_NEXT_ENGINE,
+	COMMAND_FIND_SHOT,
+	COMMAND_SEEK // jump the replay by seconds
+};
+
+struct SimulationCommand
+{
+	SimulationCommand(SimulationCommandType type = COMMAND_SHOOT);
+
+	SimulationCommandType type;
+	int angle;
+	float power;
+	float seconds;
+};
+
+class SimulationThread
+{
+	public:
+		SimulationThread(float stepTime = frame_time);
+		~SimulationThread();
+
+		void setup();
+		bool startRecording(const char *path);
+		bool startReplay(const char *path);
+
+		void start();
+		void stop();
+		bool isRunning() const;
+
+		bool send(const SimulationCommand &command);
+		bool takeFrame();
+		const TableFrame &frame() const;
+
+	private:
+		SimulationThread(const SimulationThread &);
+		SimulationThread &operator=(const SimulationThread &);
+
+		void run();
+		void apply(const SimulationCommand &command);
+		bool step();
+		void publish(long long stepDue);
+
+		void aim(int angle, float power);
+		void shoot();
+		void undo();
+		void nextEngine();
+		void findShot();
+		void seekReplay(float seconds);
+
+		World world;
+		FrameScheduler scheduler;
+		ReplayWriter recorder;
+		ReplayReader replay;
+		int replayFrame;
+
+		// the table before the last shot, for undo
+		WorldSnapshot beforeShot;
+		bool canUndo;
+
+		int cueBallAngle;
+		float cueBallPower;
+
+		// of the shot search, made by the first search; destroyed with the
+		// members, after the destructor's stop() has joined the thread
+		std::unique_ptr<ThreadPool> pool;
+
+		CommandQueue<SimulationCommand> commands;
+		TripleBuffer<TableFrame> frames;
+		bool publishedStill; // whether the last frame published was still
+
+#ifdef BILLIARD_STATS
+		long long physicsTime;
+		PhysicsCounters counters;
+#endif
+
+		std::thread thread;
+		std::atomic<bool> running;
+};
+
+#endif
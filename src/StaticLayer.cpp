@@ -0,0 +1,145 @@
+#include "StaticLayer.h"
+#include "Trace.h"
+
+StaticLayer::StaticLayer()
+	: supported(false), valid(false), width(0), height(0), allocatedWidth(0),
+	allocatedHeight(0), framebuffer(0), colorBuffer(0)
+{
+}
+
+StaticLayer::~StaticLayer()
+{
+	release();
+}
+
+/*
+* Check for framebuffer support and set the window size. Must be called with
+* a current context after glewInit(). Returns whether the layer can be used.
+*/
+bool StaticLayer::init(int width, int height)
+{
+	release();
+	supported = GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object;
+	resize(width, height);
+	return supported;
+}
+
+bool StaticLayer::isSupported() const
+{
+	return supported;
+}
+
+void StaticLayer::release()
+{
+	if (framebuffer)
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+	if (colorBuffer)
+	{
+		glDeleteRenderbuffers(1, &colorBuffer);
+	}
+
+	framebuffer = colorBuffer = 0;
+	allocatedWidth = allocatedHeight = 0;
+	valid = false;
+}
+
+/*
+* Create the framebuffer at the window size. If the driver cannot complete
+* it the layer turns itself off.
+*/
+bool StaticLayer::allocate()
+{
+	release();
+
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+							GL_RENDERBUFFER, colorBuffer);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+		GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (!complete)
+	{
+		release();
+		supported = false;
+		return false;
+	}
+
+	allocatedWidth = width;
+	allocatedHeight = height;
+	return true;
+}
+
+/*
+* The window changed size; the layer follows at the next redraw.
+*/
+void StaticLayer::resize(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	valid = false;
+}
+
+/*
+* The cached picture is out of date, e.g. after a reset.
+*/
+void StaticLayer::invalidate()
+{
+	valid = false;
+}
+
+bool StaticLayer::needsRedraw() const
+{
+	return supported && !valid;
+}
+
+/*
+* Direct drawing into the layer, which is cleared first.
+*/
+void StaticLayer::beginRedraw()
+{
+	if (width != allocatedWidth || height != allocatedHeight || !framebuffer)
+	{
+		if (!allocate())
+		{
+			return;
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void StaticLayer::endRedraw()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	valid = framebuffer != 0;
+}
+
+/*
+* Copy the layer over the whole window.
+*/
+void StaticLayer::draw()
+{
+	TRACE_ZONE("StaticLayer::draw");
+
+	if (!framebuffer)
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, allocatedWidth, allocatedHeight,
+					0, 0, allocatedWidth, allocatedHeight,
+					GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,60 @@
+/*
+* A cached picture of the parts of the scene that do not move.
+*
+* The table and the pockets only change when the game is reset or the
+* window is resized, yet they used to be drawn again every frame. The static
+* layer draws them once into an offscreen framebuffer and then copies that
+* framebuffer into the window at the start of every frame, which also takes
+* the place of clearing it. Only the balls are drawn on top.
+*
+* Usage per frame:
+*	if (layer.needsRedraw()) { layer.beginRedraw(); draw...; layer.endRedraw(); }
+*	layer.draw();
+*
+* The layer has the size of the window given to resize(); drawing into it
+* uses the current viewport and matrices as drawing into the window would.
+*
+* The layer needs framebuffer objects with blitting (OpenGL 3.0 or
+* ARB_framebuffer_object). Without them isSupported() is false and the
+* caller has to draw the static parts every frame as before.
+*/
+
+#ifndef STATIC_LAYER_H
+#define STATIC_LAYER_H
+
+#include <GL/glew.h>
+
+class StaticLayer
+{
+	public:
+		StaticLayer();
+		~StaticLayer();
+
+		bool init(int width, int height);
+		bool isSupported() const;
+
+		void resize(int width, int height);
+		void invalidate();
+		bool needsRedraw() const;
+		void beginRedraw();
+		void endRedraw();
+		void draw();
+
+	private:
+		StaticLayer(const StaticLayer &);
+		StaticLayer &operator=(const StaticLayer &);
+
+		void release();
+		bool allocate();
+
+		bool supported;
+		bool valid;
+		int width;
+		int height;
+		int allocatedWidth;
+		int allocatedHeight;
+		GLuint framebuffer;
+		GLuint colorBuffer;
+};
+
+#endif
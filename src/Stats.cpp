@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "Stats.h"
+
+#ifdef BILLIARD_STATS
+/*
+* The counters of the calling thread.
+*/
+PhysicsCounters &physicsCounters()
+{
+	static thread_local PhysicsCounters counters = {0, 0, 0, 0, 0};
+	return counters;
+}
+#endif
+
+FrameStats::FrameStats(int window)
+	: records(window), next(0), count(0), frames(0), csv(0)
+{
+}
+
+FrameStats::~FrameStats()
+{
+	stopCsv();
+}
+
+/*
+* Record one frame, dropping the oldest one from the window, and append it
+* to the CSV file if one is being written.
+*/
+void FrameStats::add(const FrameRecord &record)
+{
+	records[next] = record;
+	next = (next + 1) % records.size();
+	count = count < (int) records.size() ? count + 1 : count;
+	frames++;
+
+	if (csv)
+	{
+		fprintf(csv, "%lld,%.1f,%.1f,%lld,%lld,%lld,%lld,%lld\n", frames,
+			record.physicsTime * 1e-3, record.renderTime * 1e-3,
+			record.counters.pairTests, record.counters.collisions,
+			record.counters.cushionHits, record.counters.pocketed,
+			record.counters.substeps);
+	}
+}
+
+/*
+* The number of frames in the window.
+*/
+int FrameStats::numOfFrames() const
+{
+	return count;
+}
+
+/*
+* The latest frame. Only valid if numOfFrames() > 0.
+*/
+const FrameRecord &FrameStats::last() const
+{
+	return records[(next + records.size() - 1) % records.size()];
+}
+
+/*
+* The p-th percentile (0 to 100) of a time over the window, in nanoseconds.
+*/
+long long FrameStats::percentile(FrameSeries series, float p) const
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	std::vector<long long> values(count);
+	for (int i = 0; i < count; i++)
+	{
+		values[i] = series == SERIES_PHYSICS_TIME ?
+			records[i].physicsTime : records[i].renderTime;
+	}
+
+	int k = (int) (p / 100 * (count - 1) + 0.5f);
+	std::nth_element(values.begin(), values.begin() + k, values.end());
+	return values[k];
+}
+
+/*
+* Append every following frame to a new CSV file at path, times in
+* microseconds.
+*/
+bool FrameStats::startCsv(const char *path)
+{
+	stopCsv();
+
+	csv = fopen(path, "w");
+	if (!csv)
+	{
+		return false;
+	}
+
+	fprintf(csv, "frame,physics_us,render_us,pair_tests,collisions,"
+		"cushion_hits,pocketed,substeps\n");
+	return true;
+}
+
+void FrameStats::stopCsv()
+{
+	if (csv)
+	{
+		fclose(csv);
+	}
+
+	csv = 0;
+}
+
+bool FrameStats::isWritingCsv() const
+{
+	return csv != 0;
+}
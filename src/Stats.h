@@ -0,0 +1,82 @@
+/*
+* Counters of the work done by the physics and timings of every frame.
+*
+* The physics counts pair tests, ball-ball collisions, cushion hits,
+* pocketed balls and substeps with COUNT_STAT. The counters belong to the calling thread,
+* so worlds stepped on worker threads (see ShotSearch.h) do not disturb the
+* ones of the viewer, and the hot loops never share a cache line.
+*
+* FrameStats keeps the counters and the physics and render times of the
+* last frames, gives rolling percentiles over them and can append every
+* frame to a CSV file.
+*
+* All of this only exists when the build defines BILLIARD_STATS (the CMake
+* option of the same name). Otherwise COUNT_STAT expands to nothing and the
+* viewer leaves FrameStats out, so the hot paths are exactly as without it.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <vector>
+
+struct PhysicsCounters
+{
+	long long pairTests;
+	long long collisions;
+	long long cushionHits;
+	long long pocketed;
+	long long substeps;
+};
+
+#ifdef BILLIARD_STATS
+PhysicsCounters &physicsCounters();
+#define COUNT_STAT(counter, n) (physicsCounters().counter += (n))
+#else
+#define COUNT_STAT(counter, n) ((void) 0)
+#endif
+
+/*
+* What happened in one frame. Times are in nanoseconds.
+*/
+struct FrameRecord
+{
+	long long physicsTime;
+	long long renderTime;
+	PhysicsCounters counters;
+};
+
+enum FrameSeries
+{
+	SERIES_PHYSICS_TIME,
+	SERIES_RENDER_TIME
+};
+
+class FrameStats
+{
+	public:
+		FrameStats(int window = 240);
+		~FrameStats();
+
+		void add(const FrameRecord &record);
+		int numOfFrames() const;
+		const FrameRecord &last() const;
+		long long percentile(FrameSeries series, float p) const;
+
+		bool startCsv(const char *path);
+		void stopCsv();
+		bool isWritingCsv() const;
+
+	private:
+		FrameStats(const FrameStats &);
+		FrameStats &operator=(const FrameStats &);
+
+		std::vector<FrameRecord> records; // ring of the last frames
+		int next;
+		int count;
+		long long frames;
+		FILE *csv;
+};
+
+#endif
@@ -1,9 +1,165 @@
+#include <math.h>
 #include "Table.h"
+#include "Stats.h"
 
-Table::Table(float length) : length(length), width(length/2.0)
+Table::Table(float length)
+	: length(length), width(length/2.0), pockets(), numOfMouths()
 {
 }
 
-Table::Table(float length, float width) : length(length), width(width)
+Table::Table(float length, float width)
+	: length(length), width(width), pockets(), numOfMouths()
 {
-}
\ No newline at end of file
+}
+
+/*
+* Find where the pockets cut into the rails. Call it whenever the pockets
+* change; pockets with a radius of 0 are ignored.
+*
+* A pocket whose opening reaches over a rail cuts out the chord of its
+* circle along that rail, so pockets can sit anywhere and have any size:
+*
+*	P0------------------P1------------------P2
+*	|										|
+*	|										|
+*	|										|
+*	P3------------------P4------------------P5
+*/
+void Table::bakeMouths()
+{
+	for (int rail = 0; rail < 4; rail++)
+	{
+		numOfMouths[rail] = 0;
+
+		for (int i = 0; i < NUM_OF_POCKETS; i++)
+		{
+			const Pocket &pocket = pockets[i];
+			bool vertical = rail == LEFT_RAIL || rail == RIGHT_RAIL;
+			float line = rail == LEFT_RAIL || rail == TOP_RAIL ? 0.0f :
+				(vertical ? length : width);
+			float across = fabsf((vertical ? pocket.x : pocket.y) - line);
+			float along = vertical ? pocket.y : pocket.x;
+
+			if (!(across < pocket.radius))
+			{
+				continue;
+			}
+
+			float half = across > 0.0f ? sqrtf(pocket.radius * pocket.radius -
+				across * across) : pocket.radius;
+			Mouth &mouth = mouths[rail][numOfMouths[rail]++];
+			mouth.begin = along - half;
+			mouth.end = along + half;
+		}
+	}
+}
+
+/*
+* Whether a ball that reaches the given rail at (x, y) drops into one of the
+* pockets on that rail instead of bouncing off.
+*/
+bool Table::isPocketMouth(Rail rail, float x, float y) const
+{
+	float along = rail == LEFT_RAIL || rail == RIGHT_RAIL ? y : x;
+	bool inside = false;
+
+	for (int m = 0; m < numOfMouths[rail]; m++)
+	{
+		inside |= along > mouths[rail][m].begin && along < mouths[rail][m].end;
+	}
+
+	return inside;
+}
+
+/*
+* Whether a ball that reached the given rail at (x, y) drops, counting the
+* cushion hit if it does not.
+*/
+static inline bool drops(const Table &table, Rail rail, float x, float y,
+						bool cueBall, bool &scratched)
+{
+	if (table.isPocketMouth(rail, x, y))
+	{
+		if (!cueBall)
+		{
+			return true;
+		}
+		scratched = true;
+	}
+
+	COUNT_STAT(cushionHits, 1);
+	return false;
+}
+
+/*
+* Move a ball at (x, y) for timePassed seconds in a straight line, bouncing
+* it off every cushion at the moment it reaches it and going on with the
+* rest of the step, so a fast ball or a long step never ends up behind a
+* rail. The cushion sends the ball back with bounciness times the speed it
+* came in with across it. Returns true if it reaches a cushion inside a
+* pocket mouth instead and drops; it is left where it dropped. The cue ball never drops; it
+* bounces back and sets scratched.
+*
+* A ball that starts behind a rail and moves away from the table bounces
+* at once; one that is already on its way back is left alone.
+*/
+bool Table::sweep(float &x, float &y, float radius, float &vx, float &vy,
+				float timePassed, float bounciness, bool cueBall,
+				bool &scratched) const
+{
+	const float left = radius;
+	const float right = length - radius;
+	const float top = radius;
+	const float bottom = width - radius;
+
+	// a ball wider than the table would bounce forever
+	for (int hits = 0; hits < max_cushion_hits; hits++)
+	{
+		float endX = x + timePassed * vx;
+		float endY = y + timePassed * vy;
+		bool crossesX = (vx < 0 && endX < left) || (vx > 0 && endX > right);
+		bool crossesY = (vy < 0 && endY < top) || (vy > 0 && endY > bottom);
+
+		if (!crossesX && !crossesY)
+		{
+			x = endX;
+			y = endY;
+			return false;
+		}
+
+		// the time until the ball touches each rail it crosses
+		float timeX = crossesX ? ((vx < 0 ? left : right) - x) / vx : 0;
+		float timeY = crossesY ? ((vy < 0 ? top : bottom) - y) / vy : 0;
+		bool firstX = crossesX && (!crossesY || timeX <= timeY);
+		float time = firstX ? timeX : timeY;
+		if (time < 0)
+		{
+			time = 0;
+		}
+
+		x += time * vx;
+		y += time * vy;
+		timePassed -= time;
+
+		Rail rail;
+		if (firstX)
+		{
+			rail = vx < 0 ? LEFT_RAIL : RIGHT_RAIL;
+			vx = -bounciness * vx;
+		}
+		else
+		{
+			rail = vy < 0 ? TOP_RAIL : BOTTOM_RAIL;
+			vy = -bounciness * vy;
+		}
+
+		if (drops(*this, rail, x, y, cueBall, scratched))
+		{
+			return true;
+		}
+	}
+
+	x += timePassed * vx;
+	y += timePassed * vy;
+	return false;
+}
@@ -1,19 +1,54 @@
 #ifndef TABLE_H
 #define TABLE_H
 
-//TODO: keep track of location of pockets, size of pockets, color maybe
 //TODO: allow presets by overload constructors
 //TODO: might also add a method that gives the conversion factor
-//NOTE: should a table have the balls? or should the balls be in billiard?
 //NOTE: should the table keep track of its own xyz coordinate?
 
+#define NUM_OF_POCKETS 6
+
+// the most cushions a ball can bounce off in one step
+const int max_cushion_hits = 8;
+
+enum Rail
+{
+	LEFT_RAIL,
+	RIGHT_RAIL,
+	TOP_RAIL,
+	BOTTOM_RAIL
+};
+
+struct Pocket
+{
+	float x;
+	float y;
+	float radius;
+};
+
+// the stretch of a rail that a pocket cuts out, along the rail
+struct Mouth
+{
+	float begin;
+	float end;
+};
+
 class Table
 {
 	public:
 		Table(float length);
 		Table(float length, float width);
+		void bakeMouths();
+		bool isPocketMouth(Rail rail, float x, float y) const;
+		bool sweep(float &x, float &y, float radius, float &vx, float &vy,
+				float timePassed, float bounciness, bool cueBall,
+				bool &scratched) const;
 		float length;
 		float width;
+		Pocket pockets[NUM_OF_POCKETS];
+
+		// baked from the pockets by bakeMouths(), indexed by Rail
+		Mouth mouths[4][NUM_OF_POCKETS];
+		int numOfMouths[4];
 };
 
 #endif
\ No newline at end of file
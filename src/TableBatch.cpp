@@ -0,0 +1,487 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NarrowPhase.h"
+#include "Stats.h"
+#include "TableBatch.h"
+#include "Trace.h"
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+	defined(__linux__)
+#	define BATCH_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#	define BATCH_KERNEL
+#endif
+
+const int batch_align = 64;
+const float batch_degree_to_radian = 3.14159265f/180.f;
+
+/*
+* Bytes of one array of the block, rounded up so the next one starts
+* aligned.
+*/
+static size_t batchArrayBytes(int entries, size_t elementSize)
+{
+	size_t bytes = entries * elementSize;
+	return (bytes + batch_align - 1) / batch_align * batch_align;
+}
+
+TableBatch::TableBatch(int numOfBalls)
+	: count(numOfBalls), table(World().getTable())
+{
+	const int entries = count * batch_lanes;
+	size_t floats = batchArrayBytes(entries, sizeof(float));
+	size_t ints = batchArrayBytes(entries, sizeof(int));
+
+	memory = (char *) malloc(5 * floats + 4 * ints +
+		batchArrayBytes(count + 1, sizeof(int)) + batch_align);
+	char *p = (char *) (((uintptr_t) memory + batch_align - 1) /
+		batch_align * batch_align);
+
+	x = (float *) p;		p += floats;
+	y = (float *) p;		p += floats;
+	vx = (float *) p;		p += floats;
+	vy = (float *) p;		p += floats;
+	radius = (float *) p;	p += floats;
+	id = (int *) p;			p += ints;
+	active = (int *) p;		p += ints;
+	awake = (int *) p;		p += ints;
+	contact = (int *) p;	p += ints;
+	awakeRows = (int *) p;
+
+	for (int lane = 0; lane < batch_lanes; lane++)
+	{
+		clear(lane);
+	}
+}
+
+TableBatch::~TableBatch()
+{
+	free(memory);
+}
+
+/*
+* Copy the balls of a world into a lane. The first world loaded also gives
+* the table of all lanes. Returns false if the world has a different number
+* of balls or does not use MOTION_DAMPING, the only motion of the batch.
+*/
+bool TableBatch::load(int lane, const World &world)
+{
+	const BallSystem &balls = world.getBalls();
+	if (balls.size() != count || world.motionModel() != MOTION_DAMPING)
+	{
+		return false;
+	}
+
+	bool first = true;
+	for (int k = 0; k < batch_lanes; k++)
+	{
+		first = first && !loaded[k];
+	}
+	if (first)
+	{
+		table = world.getTable();
+	}
+
+	for (int b = 0; b < count; b++)
+	{
+		int i = b * batch_lanes + lane;
+		x[i] = balls.x[b];
+		y[i] = balls.y[b];
+		vx[i] = balls.vx[b];
+		vy[i] = balls.vy[b];
+		radius[i] = balls.radius[b];
+		id[i] = balls.id[b];
+		active[i] = balls.active[b] ? -1 : 0;
+		awake[i] = 0;
+	}
+
+	scratched[lane] = world.cueBallScratched();
+	loaded[lane] = -1;
+	return true;
+}
+
+/*
+* Copy a lane back into a world with the same number of balls, e.g. the one
+* it was loaded from. Returns false if the number differs.
+*/
+bool TableBatch::store(int lane, World &world) const
+{
+	BallSystem balls = world.getBalls();
+	if (balls.size() != count)
+	{
+		return false;
+	}
+
+	for (int b = 0; b < count; b++)
+	{
+		int i = b * batch_lanes + lane;
+		balls.x[b] = balls.lastX[b] = x[i];
+		balls.y[b] = balls.lastY[b] = y[i];
+		balls.vx[b] = vx[i];
+		balls.vy[b] = vy[i];
+		balls.radius[b] = radius[i];
+		balls.id[b] = id[i];
+		balls.active[b] = active[i] != 0;
+	}
+
+	world.restoreBalls(balls, scratched[lane]);
+	return true;
+}
+
+/*
+* Empty a lane. Its balls are off the table and it is never stepped.
+*/
+void TableBatch::clear(int lane)
+{
+	for (int b = 0; b < count; b++)
+	{
+		int i = b * batch_lanes + lane;
+		x[i] = y[i] = far_away;
+		vx[i] = vy[i] = 0.0f;
+		radius[i] = 0.0f;
+		id[i] = -1;
+		active[i] = 0;
+		awake[i] = 0;
+	}
+
+	scratched[lane] = false;
+	loaded[lane] = 0;
+}
+
+/*
+* Shoot the cue ball of a lane, like World::shoot().
+*/
+void TableBatch::shoot(int lane, float angle, float power)
+{
+	for (int b = 0; b < count; b++)
+	{
+		int i = b * batch_lanes + lane;
+		if (id[i] == 0)
+		{
+			float speed = power * max_cue_speed;
+			vx[i] = sin(angle * batch_degree_to_radian) * speed;
+			vy[i] = cos(angle * batch_degree_to_radian) * speed;
+			scratched[lane] = false;
+			return;
+		}
+	}
+}
+
+/*
+* Move ball entry i, which belongs to the given lane, for timePassed
+* seconds, bouncing it off the cushions on the way. Returns 1 if it went
+* into a pocket.
+*/
+int TableBatch::bounce(int i, int lane, float timePassed)
+{
+	if (table.sweep(x[i], y[i], radius[i], vx[i], vy[i], timePassed, 1.0f,
+		id[i] == 0, scratched[lane]))
+	{
+		active[i] = 0;
+		return 1;
+	}
+
+	return 0;
+}
+
+// one ball of every lane; the masks are -1 in the lanes where they hold
+typedef float LaneFloat __attribute__((vector_size(batch_lanes * sizeof(float))));
+typedef int LaneMask __attribute__((vector_size(batch_lanes * sizeof(int))));
+typedef long long LanePairs __attribute__((vector_size(batch_lanes * sizeof(int))));
+
+static inline bool anyLane(const LaneMask &mask)
+{
+	LanePairs pairs = (LanePairs) mask;
+	long long any = 0;
+	for (size_t k = 0; k < sizeof(LanePairs) / sizeof(long long); k++)
+	{
+		any |= pairs[k];
+	}
+
+	return any != 0;
+}
+
+/*
+* Mark the balls that are on the table and moving in a loaded lane as
+* awake and move them, except the ones that would end up behind a rail:
+* those are flagged in contact and left for Table::sweep.
+* The balls awake in any lane are listed in awakeRows, after their count.
+* Returns whether any ball reached a cushion.
+*/
+BATCH_KERNEL
+static bool moveAwakeBalls(int n, float *x, float *y, const float *vx,
+	const float *vy, const float *radius, const int *active,
+	const int *loaded, int *awake, int *contact, int *awakeRows,
+	float timePassed, float length, float width)
+{
+	LaneFloat *X = (LaneFloat *) x;
+	LaneFloat *Y = (LaneFloat *) y;
+	const LaneFloat *VX = (const LaneFloat *) vx;
+	const LaneFloat *VY = (const LaneFloat *) vy;
+	const LaneFloat *R = (const LaneFloat *) radius;
+	const LaneMask *A = (const LaneMask *) active;
+	LaneMask *AW = (LaneMask *) awake;
+	LaneMask *C = (LaneMask *) contact;
+
+	LaneMask live;
+	memcpy(&live, loaded, sizeof(live));
+	const LaneFloat none = {};
+	LaneMask anyContact = {};
+	int rows = 0;
+
+	for (int b = 0; b < n; b++)
+	{
+		LaneMask moving = A[b] & live & ((VX[b] != 0.0f) | (VY[b] != 0.0f));
+		LaneFloat move = moving ? none + timePassed : none;
+
+		LaneFloat endX = X[b] + move * VX[b];
+		LaneFloat endY = Y[b] + move * VY[b];
+
+		AW[b] = moving;
+		C[b] = moving & ((endX < R[b]) | (endX > length - R[b]) |
+			(endY < R[b]) | (endY > width - R[b]));
+		X[b] = C[b] ? X[b] : endX;
+		Y[b] = C[b] ? Y[b] : endY;
+		anyContact |= C[b];
+
+		if (anyLane(moving))
+		{
+			awakeRows[++rows] = b;
+		}
+	}
+
+	awakeRows[0] = rows;
+	return anyLane(anyContact);
+}
+
+/*
+* Whether balls a and b overlap in each lane where both are on the table and
+* at least one of them is awake.
+*/
+#define PAIR_HITS(a, b, X, Y, R, A, AW) \
+	(A[a] & A[b] & (AW[a] | AW[b]) & \
+	((X[b] - X[a]) * (X[b] - X[a]) + (Y[b] - Y[a]) * (Y[b] - Y[a]) <= \
+	(R[b] + R[a]) * (R[b] + R[a])))
+
+/*
+* Test every pair of balls with at least one awake ball in all lanes at
+* once and resolve the overlaps lane by lane, in the pair order of the
+* fixed stepper. A sleeping ball that is hit wakes up and is added to
+* awakeRows. Returns the number of collisions.
+*
+* A ball asleep in every lane only needs to be tested against the balls in
+* awakeRows. Hits are rare, so the pairs of ball a are first tested without
+* a branch; only if one of them hits are they gone through again one by
+* one, seeing the positions and velocities that the earlier collisions
+* changed.
+*/
+BATCH_KERNEL
+static int resolveCollisions(int n, float *x, float *y, float *vx, float *vy,
+	const float *radius, const int *active, int *awake, int *awakeRows,
+	float timePassed)
+{
+	const LaneFloat *X = (const LaneFloat *) x;
+	const LaneFloat *Y = (const LaneFloat *) y;
+	const LaneFloat *R = (const LaneFloat *) radius;
+	const LaneMask *A = (const LaneMask *) active;
+	LaneMask *AW = (LaneMask *) awake;
+	const LaneMask none = {};
+	int collisions = 0;
+
+	for (int a = 0; a < n; a++)
+	{
+		bool asleep = !anyLane(AW[a]);
+		LaneMask anyHit = {};
+
+		if (asleep)
+		{
+			for (int r = 1; r <= awakeRows[0]; r++)
+			{
+				int b = awakeRows[r];
+				anyHit |= b > a ? PAIR_HITS(a, b, X, Y, R, A, AW) : none;
+			}
+		}
+		else
+		{
+			for (int b = a + 1; b < n; b++)
+			{
+				anyHit |= PAIR_HITS(a, b, X, Y, R, A, AW);
+			}
+		}
+
+		if (!anyLane(anyHit))
+		{
+			continue;
+		}
+
+		for (int b = a + 1; b < n; b++)
+		{
+			LaneMask hit = PAIR_HITS(a, b, X, Y, R, A, AW);
+			if (!anyLane(hit))
+			{
+				continue;
+			}
+
+			for (int k = 0; k < batch_lanes; k++)
+			{
+				if (hit[k])
+				{
+					collide(x, y, vx, vy, radius, a * batch_lanes + k,
+						b * batch_lanes + k, timePassed);
+					collisions++;
+				}
+			}
+
+			if (!anyLane(AW[a]))
+			{
+				awakeRows[++awakeRows[0]] = a;
+			}
+			if (!anyLane(AW[b]))
+			{
+				awakeRows[++awakeRows[0]] = b;
+			}
+			AW[a] |= hit;
+			AW[b] |= hit;
+		}
+	}
+
+	return collisions;
+}
+
+/*
+* Damp the awake balls and stop the ones that got slower than rest_speed.
+*/
+BATCH_KERNEL
+static void dampAwakeBalls(float *vx, float *vy, const int *active,
+	const int *awake, const int *awakeRows, float damping)
+{
+	LaneFloat *VX = (LaneFloat *) vx;
+	LaneFloat *VY = (LaneFloat *) vy;
+	const LaneMask *A = (const LaneMask *) active;
+	const LaneMask *AW = (const LaneMask *) awake;
+	const float rest = rest_speed * rest_speed;
+	const LaneFloat none = {};
+
+	for (int r = 1; r <= awakeRows[0]; r++)
+	{
+		int b = awakeRows[r];
+		LaneMask damped = A[b] & AW[b];
+		LaneFloat dx = damping * VX[b];
+		LaneFloat dy = damping * VY[b];
+		LaneMask moving = damped & (dx * dx + dy * dy >= rest);
+
+		VX[b] = moving ? dx : (damped ? none : VX[b]);
+		VY[b] = moving ? dy : (damped ? none : VY[b]);
+	}
+}
+
+/*
+* Advance every loaded lane by timePassed seconds with the phases of the
+* fixed stepper. Returns the number of balls that fell into a pocket in
+* all lanes together.
+*/
+int TableBatch::step(float timePassed)
+{
+	TRACE_ZONE("TableBatch::step");
+
+	const int entries = count * batch_lanes;
+	int pocketed = 0;
+
+	if (moveAwakeBalls(count, x, y, vx, vy, radius, active, loaded, awake,
+		contact, awakeRows, timePassed, table.length, table.width))
+	{
+		for (int i = 0; i < entries; i++)
+		{
+			if (contact[i])
+			{
+				pocketed += bounce(i, i % batch_lanes, timePassed);
+			}
+		}
+	}
+
+	{
+		TRACE_ZONE("collisions");
+		int collisions = resolveCollisions(count, x, y, vx, vy, radius,
+			active, awake, awakeRows, timePassed);
+		COUNT_STAT(collisions, collisions);
+		(void) collisions; // only counted with BILLIARD_STATS
+	}
+
+	const float damping = pow(velocity_damping, timePassed / frame_time);
+	dampAwakeBalls(vx, vy, active, awake, awakeRows, damping);
+
+	COUNT_STAT(pocketed, pocketed);
+	return pocketed;
+}
+
+/*
+* Step until every table has stopped or maxSteps have been taken. Returns
+* the number of steps taken.
+*/
+int TableBatch::runUntilRest(float timeStep, int maxSteps)
+{
+	int steps = 0;
+
+	while (steps < maxSteps && isMoving())
+	{
+		step(timeStep);
+		steps++;
+	}
+
+	return steps;
+}
+
+int TableBatch::numOfBalls() const
+{
+	return count;
+}
+
+bool TableBatch::isLoaded(int lane) const
+{
+	return loaded[lane] != 0;
+}
+
+bool TableBatch::isMoving(int lane) const
+{
+	for (int b = 0; b < count; b++)
+	{
+		int i = b * batch_lanes + lane;
+		if (active[i] && (vx[i] != 0.0f || vy[i] != 0.0f))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TableBatch::isMoving() const
+{
+	for (int lane = 0; lane < batch_lanes; lane++)
+	{
+		if (loaded[lane] && isMoving(lane))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TableBatch::cueBallScratched(int lane) const
+{
+	return scratched[lane];
+}
+
+int TableBatch::ballsOnTable(int lane) const
+{
+	int balls = 0;
+	for (int b = 0; b < count; b++)
+	{
+		balls += active[b * batch_lanes + lane] != 0;
+	}
+
+	return balls;
+}
@@ -0,0 +1,85 @@
+/*
+* batch_lanes tables stepped together, lane k of every array being table k.
+*
+* One table holds too few balls for SIMD to pay off within it, but many
+* tables playing the same kind of shot do the same work side by side. A
+* TableBatch keeps the balls of batch_lanes worlds in one structure of
+* arrays, ball by ball, with the lanes of a ball next to each other, so a
+* vector register holds one ball of every table. The phases of
+* World::stepFixed then run across all tables at once: the move, the
+* cushion test, the overlap test of every pair and the damping are done a
+* full register at a time. What follows a hit, the bounce off a cushion
+* (Table::sweep) and collide(), is rare and runs per lane, through the same
+* functions as in World, so every lane computes exactly what a World would.
+*
+* As in World, balls at rest are not moved or damped, and a pair is only
+* tested if one of its balls moves; a ball is skipped only when it rests in
+* every lane.
+*
+* The pairs are tested in the order of the fixed stepper when most balls
+* move; when only a few of them do, World visits the moving balls first, so
+* a ball that touches two others in the same step can be resolved in a
+* different order there.
+*
+* All lanes share the table of the world loaded first and have the same
+* number of balls. Lanes that were not loaded, and tables whose balls have
+* all stopped, are masked off and left untouched.
+*
+* On x86 Linux with GCC the vector loops are compiled twice, for AVX2 and
+* for the baseline, and the loader picks one for the CPU.
+*/
+
+#ifndef TABLE_BATCH_H
+#define TABLE_BATCH_H
+
+#include "World.h"
+
+const int batch_lanes = 8;
+
+class TableBatch
+{
+	public:
+		TableBatch(int numOfBalls = NUM_OF_BALLS);
+		~TableBatch();
+
+		bool load(int lane, const World &world);
+		bool store(int lane, World &world) const;
+		void clear(int lane);
+
+		void shoot(int lane, float angle, float power);
+		int step(float timePassed);
+		int runUntilRest(float timeStep, int maxSteps);
+
+		int numOfBalls() const;
+		bool isLoaded(int lane) const;
+		bool isMoving(int lane) const;
+		bool isMoving() const;
+		bool cueBallScratched(int lane) const;
+		int ballsOnTable(int lane) const;
+
+	private:
+		TableBatch(const TableBatch &);
+		TableBatch &operator=(const TableBatch &);
+
+		int bounce(int i, int lane, float timePassed);
+
+		int count;
+		Table table;
+		bool scratched[batch_lanes];
+		int loaded[batch_lanes];
+
+		// numOfBalls * batch_lanes entries each, in one aligned block
+		float *x;
+		float *y;
+		float *vx;
+		float *vy;
+		float *radius;
+		int *id;
+		int *active;
+		int *awake;
+		int *contact; // whether the ball touches a cushion this step
+		int *awakeRows; // count, then the balls awake in any lane
+		char *memory;
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifdef __linux__
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+#include "ShotSearch.h"
+#include "TableService.h"
+#include "Trace.h"
+
+TableServiceOptions::TableServiceOptions()
+	: games(1000), threads(0), tablesPerThread(4), seed(1),
+	engine(ENGINE_FIXED_STEP), timeStep(frame_time), maxShots(60),
+	maxStepsPerShot(10000), batchSteps(64), pinThreads(true),
+	queueCapacity(1024)
+{
+}
+
+/*
+* Pin the calling thread to the n-th core the process may run on. Does
+* nothing where thread affinity is not supported.
+*/
+static void pinToCore(int n)
+{
+#ifdef __linux__
+	cpu_set_t allowed;
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+	{
+		return;
+	}
+
+	int count = CPU_COUNT(&allowed);
+	if (count <= 0)
+	{
+		return;
+	}
+
+	n %= count;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (CPU_ISSET(cpu, &allowed) && n-- == 0)
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+			return;
+		}
+	}
+#endif
+}
+
+TableService::TableService(const TableServiceOptions &options)
+	: options(options), results(options.queueCapacity), nextGame(0),
+	running(0), stopping(false)
+{
+	numOfWorkers = options.threads > 0 ? options.threads :
+		(int) std::thread::hardware_concurrency();
+	if (numOfWorkers <= 0)
+	{
+		numOfWorkers = 1;
+	}
+}
+
+TableService::~TableService()
+{
+	stop();
+}
+
+/*
+* Start playing the games on the threads. Returns right away.
+*/
+void TableService::start()
+{
+	if (!threads.empty())
+	{
+		return;
+	}
+
+	running = numOfWorkers;
+	for (int i = 0; i < numOfWorkers; i++)
+	{
+		threads.push_back(std::thread(&TableService::run, this, i));
+	}
+}
+
+/*
+* Take the result of one finished game, if there is one. Games finish in no
+* particular order.
+*/
+bool TableService::poll(GameResult &result)
+{
+	return results.pop(result);
+}
+
+/*
+* Whether games are still being played. Once this is false, every result is
+* in the queue.
+*/
+bool TableService::isRunning() const
+{
+	return running > 0;
+}
+
+/*
+* End the games that are still being played, without results, and wait for
+* the threads.
+*/
+void TableService::stop()
+{
+	stopping = true;
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+	threads.clear();
+}
+
+int TableService::numOfThreads() const
+{
+	return numOfWorkers;
+}
+
+/*
+* Rack the next game on the given table. Returns false if all games have
+* been handed out.
+*/
+bool TableService::rack(Game &game, int thread)
+{
+	int next = nextGame++;
+	if (next >= options.games || stopping)
+	{
+		game.playing = false;
+		return false;
+	}
+
+	game.world.setEngine(options.engine);
+	game.world.setup();
+	game.result.game = next;
+	game.result.shots = 0;
+	game.result.pocketed = 0;
+	game.result.scratches = 0;
+	game.result.steps = 0;
+	game.result.thread = thread;
+	game.playing = true;
+
+	playNext(game, thread);
+	return game.playing;
+}
+
+/*
+* Called when the balls of a table came to rest: play the next shot, or
+* hand in the result of the game and rack the next one.
+*/
+void TableService::playNext(Game &game, int thread)
+{
+	World &world = game.world;
+	GameResult &result = game.result;
+
+	if (result.shots > 0 && world.cueBallScratched())
+	{
+		result.scratches++;
+	}
+
+	int objectBalls = -1;
+	for (int i = 0; i < world.numOfBalls(); i++)
+	{
+		objectBalls += world.isBallVisible(i);
+	}
+
+	if (objectBalls > 0 && result.shots < options.maxShots)
+	{
+		Shot shot = candidateShot(options.seed,
+			result.game * options.maxShots + result.shots);
+		world.shoot(shot.angle, shot.power);
+		result.shots++;
+		game.stepsThisShot = 0;
+		return;
+	}
+
+	while (!results.push(result))
+	{
+		if (stopping)
+		{
+			break;
+		}
+		std::this_thread::yield();
+	}
+
+	rack(game, thread);
+}
+
+/*
+* The loop of one thread: step every table it owns by a batch of steps in
+* turn until no game is left.
+*/
+void TableService::run(int thread)
+{
+	if (options.pinThreads)
+	{
+		pinToCore(thread);
+	}
+	setTraceThreadName("table");
+
+	// created here, so the worlds live in memory close to this core
+	std::vector<Game> games(options.tablesPerThread > 0 ?
+		options.tablesPerThread : 1);
+	int playing = 0;
+	for (size_t i = 0; i < games.size(); i++)
+	{
+		playing += rack(games[i], thread);
+	}
+
+	while (playing > 0 && !stopping)
+	{
+		TRACE_ZONE("table batch");
+
+		for (size_t i = 0; i < games.size(); i++)
+		{
+			Game &game = games[i];
+
+			for (int s = 0; game.playing && s < options.batchSteps; s++)
+			{
+				if (!game.world.isMoving() ||
+					game.stepsThisShot >= options.maxStepsPerShot)
+				{
+					playNext(game, thread);
+					if (!game.playing)
+					{
+						playing--;
+						break;
+					}
+				}
+
+				game.result.pocketed += game.world.step(options.timeStep);
+				game.result.steps++;
+				game.stepsThisShot++;
+			}
+		}
+	}
+
+	running--;
+}
@@ -0,0 +1,99 @@
+/*
+* Plays thousands of independent games on many tables at once, for
+* tournament style statistics.
+*
+* A game racks the standard balls and plays random shots (see candidateShot
+* in ShotSearch.h) until every object ball is pocketed or maxShots have been
+* taken. Game g always gets the same shots for the same seed, so its result
+* does not depend on the number of threads or tables.
+*
+* The service starts one thread per core, pinned to that core where the
+* system allows it. Every thread owns its share of the tables outright: the
+* worlds are created on that thread and no other thread touches them, so the
+* threads share nothing they write to but the counter handing out the next
+* game and the results queue. A thread steps each of its tables by
+* batchSteps steps in turn; when the balls of a table come to rest it plays
+* the next shot, or pushes the result of the finished game to a lock-free
+* queue (see ResultQueue.h) and racks the next one.
+*
+* poll() takes the results on the calling thread while the games run. When
+* the queue is full the threads wait for it to be drained, so a consumer
+* that keeps up never slows them down. stop(), also called by the
+* destructor, ends the games early and waits for the threads; results still
+* in the queue can be polled afterwards.
+*/
+
+#ifndef TABLE_SERVICE_H
+#define TABLE_SERVICE_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ResultQueue.h"
+#include "World.h"
+
+struct GameResult
+{
+	int game;
+	int shots;
+	int pocketed;
+	int scratches;
+	long long steps;
+	int thread;
+};
+
+struct TableServiceOptions
+{
+	TableServiceOptions();
+
+	int games;
+	int threads; // 0 for one per hardware thread
+	int tablesPerThread;
+	unsigned int seed;
+	EngineType engine;
+	float timeStep;
+	int maxShots;
+	int maxStepsPerShot;
+	int batchSteps;
+	bool pinThreads;
+	int queueCapacity;
+};
+
+class TableService
+{
+	public:
+		TableService(const TableServiceOptions &options);
+		~TableService();
+
+		void start();
+		bool poll(GameResult &result);
+		bool isRunning() const;
+		void stop();
+		int numOfThreads() const;
+
+	private:
+		struct Game
+		{
+			World world;
+			GameResult result;
+			int stepsThisShot;
+			bool playing;
+		};
+
+		TableService(const TableService &);
+		TableService &operator=(const TableService &);
+
+		void run(int thread);
+		bool rack(Game &game, int thread);
+		void playNext(Game &game, int thread);
+
+		TableServiceOptions options;
+		int numOfWorkers;
+		std::vector<std::thread> threads;
+		ResultQueue<GameResult> results;
+		std::atomic<int> nextGame;
+		std::atomic<int> running;
+		std::atomic<bool> stopping;
+};
+
+#endif
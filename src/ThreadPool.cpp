@@ -0,0 +1,160 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+// the pool and worker the current thread belongs to, if any
+static thread_local ThreadPool *currentPool = 0;
+static thread_local int currentWorker = -1;
+
+/*
+* Start the workers. With numOfThreads 0 there is one per hardware thread.
+*/
+ThreadPool::ThreadPool(int numOfThreads)
+	: queued(0), pending(0), nextWorker(0), stopping(false)
+{
+	if (numOfThreads <= 0)
+	{
+		numOfThreads = std::thread::hardware_concurrency();
+	}
+	if (numOfThreads <= 0)
+	{
+		numOfThreads = 1;
+	}
+
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		workers.push_back(new Worker());
+	}
+
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		threads.push_back(std::thread(&ThreadPool::run, this, i));
+	}
+}
+
+/*
+* Finish the queued tasks and stop the workers.
+*/
+ThreadPool::~ThreadPool()
+{
+	wait();
+
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		delete workers[i];
+	}
+}
+
+int ThreadPool::size() const
+{
+	return (int) workers.size();
+}
+
+void ThreadPool::submit(const Task &task)
+{
+	int index = currentPool == this ? currentWorker :
+		(int) (nextWorker++ % workers.size());
+
+	// the counters go up before the task can be taken, so they never drop
+	// below the number of tasks actually queued. Taking sleepLock orders the
+	// increment before the check of a worker that is about to sleep.
+	pending++;
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		queued++;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(workers[index]->lock);
+		workers[index]->tasks.push_back(task);
+	}
+	wakeUp.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> guard(sleepLock);
+	while (pending > 0)
+	{
+		finished.wait(guard);
+	}
+}
+
+/*
+* Take a task from the back of the worker's own deque or, failing that, from
+* the front of another one.
+*/
+bool ThreadPool::take(int index, Task &task)
+{
+	Worker *own = workers[index];
+	{
+		std::lock_guard<std::mutex> guard(own->lock);
+		if (!own->tasks.empty())
+		{
+			task = own->tasks.back();
+			own->tasks.pop_back();
+			return true;
+		}
+	}
+
+	const int n = (int) workers.size();
+	for (int k = 1; k < n; k++)
+	{
+		Worker *victim = workers[(index + k) % n];
+		std::lock_guard<std::mutex> guard(victim->lock);
+		if (!victim->tasks.empty())
+		{
+			task = victim->tasks.front();
+			victim->tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::run(int index)
+{
+	currentPool = this;
+	currentWorker = index;
+	setTraceThreadName("worker");
+
+	for (;;)
+	{
+		Task task;
+
+		if (take(index, task))
+		{
+			queued--;
+			task();
+
+			if (--pending == 0)
+			{
+				std::lock_guard<std::mutex> guard(sleepLock);
+				finished.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		while (queued == 0 && !stopping)
+		{
+			wakeUp.wait(guard);
+		}
+
+		if (stopping && queued == 0)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+/*
+* A fixed set of worker threads with work stealing.
+*
+* Every worker has its own deque of tasks. A worker takes new work from the
+* back of its own deque, and when that is empty it steals from the front of
+* another worker's deque. Tasks of very different cost therefore still keep
+* every core busy: a worker that finishes early helps out the others instead
+* of waiting. Tasks submitted from inside a task go to the deque of the
+* worker running it; tasks submitted from outside are dealt round robin.
+*
+* Idle workers sleep until work arrives. wait() blocks until every task
+* submitted so far has finished.
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+	public:
+		typedef std::function<void()> Task;
+
+		ThreadPool(int numOfThreads = 0);
+		~ThreadPool();
+
+		int size() const;
+		void submit(const Task &task);
+		void wait();
+
+	private:
+		struct Worker
+		{
+			std::mutex lock;
+			std::deque<Task> tasks;
+		};
+
+		ThreadPool(const ThreadPool &);
+		ThreadPool &operator=(const ThreadPool &);
+
+		void run(int index);
+		bool take(int index, Task &task);
+
+		std::vector<Worker *> workers;
+		std::vector<std::thread> threads;
+
+		std::mutex sleepLock;
+		std::condition_variable wakeUp;
+		std::condition_variable finished;
+		std::atomic<int> queued;
+		std::atomic<int> pending;
+		std::atomic<unsigned int> nextWorker;
+		bool stopping;
+};
+
+#endif
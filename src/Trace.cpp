@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <mutex>
+#include <vector>
+#include "Trace.h"
+
+std::atomic<bool> trace_enabled(false);
+
+struct TraceEvent
+{
+	const char *name;
+	long long start;
+	long long duration;
+};
+
+/*
+* The zones of one thread. Only that thread writes; count is published
+* after each event so writeTrace() can read the events before it.
+*/
+struct TraceBuffer
+{
+	int thread;
+	std::atomic<const char *> name;
+	std::atomic<long long> count;
+	TraceEvent events[trace_buffer_size];
+};
+
+// the buffers of all threads that recorded a zone, in order of creation
+static std::mutex &registryLock()
+{
+	static std::mutex lock;
+	return lock;
+}
+
+static std::vector<TraceBuffer *> &buffers()
+{
+	static std::vector<TraceBuffer *> all;
+	return all;
+}
+
+// zones that started before this are not written; both clocks at that time
+static std::atomic<long long> trace_start(0);
+static std::atomic<long long> trace_start_nanoseconds(0);
+
+static thread_local TraceBuffer *threadBuffer = 0;
+static thread_local const char *threadName = 0;
+
+/*
+* The buffer of the calling thread, created on its first zone.
+*/
+static TraceBuffer *currentBuffer()
+{
+	if (!threadBuffer)
+	{
+		std::lock_guard<std::mutex> guard(registryLock());
+
+		threadBuffer = new TraceBuffer();
+		threadBuffer->thread = (int) buffers().size() + 1;
+		threadBuffer->name = threadName;
+		threadBuffer->count = 0;
+		buffers().push_back(threadBuffer);
+	}
+
+	return threadBuffer;
+}
+
+void recordTraceZone(const char *name, long long start, long long duration)
+{
+	TraceBuffer *buffer = currentBuffer();
+	long long count = buffer->count.load(std::memory_order_relaxed);
+
+	TraceEvent &event = buffer->events[count & (trace_buffer_size - 1)];
+	event.name = name;
+	event.start = start;
+	event.duration = duration;
+
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+/*
+* Start recording zones. A following writeTrace() only writes the zones
+* from here on.
+*/
+void startTracing()
+{
+	trace_start_nanoseconds = monotonicNanoseconds();
+	trace_start = traceClock();
+	trace_enabled = true;
+}
+
+void stopTracing()
+{
+	trace_enabled = false;
+}
+
+bool isTracing()
+{
+	return trace_enabled;
+}
+
+/*
+* Name the calling thread in the trace, e.g. "main" or "worker". The name
+* must be a string literal.
+*/
+void setTraceThreadName(const char *name)
+{
+	threadName = name;
+	if (threadBuffer)
+	{
+		threadBuffer->name = name;
+	}
+}
+
+/*
+* Write the zones recorded since startTracing() to the file at path as
+* Chrome trace JSON. Times are in microseconds from startTracing().
+*/
+bool writeTrace(const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	// ticks of traceClock() per microsecond
+	const long long since = trace_start;
+	double elapsed = (double)
+		(monotonicNanoseconds() - trace_start_nanoseconds);
+	double ticks = elapsed > 0 ? (double) (traceClock() - since) * 1e3 /
+		elapsed : 1e3;
+	if (!(ticks > 0))
+	{
+		ticks = 1e3;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+
+	std::lock_guard<std::mutex> guard(registryLock());
+	bool first = true;
+
+	for (size_t b = 0; b < buffers().size(); b++)
+	{
+		const TraceBuffer *buffer = buffers()[b];
+		const char *name = buffer->name;
+
+		fprintf(file, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", "
+			"\"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s %d\"}}",
+			first ? "" : ",", buffer->thread, name ? name : "thread",
+			buffer->thread);
+		first = false;
+
+		long long count = buffer->count.load(std::memory_order_acquire);
+		long long oldest = count > trace_buffer_size ?
+			count - trace_buffer_size : 0;
+
+		for (long long k = oldest; k < count; k++)
+		{
+			const TraceEvent &event =
+				buffer->events[k & (trace_buffer_size - 1)];
+			if (event.start < since)
+			{
+				continue;
+			}
+
+			fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+				"\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}", event.name,
+				buffer->thread, (event.start - since) / ticks,
+				event.duration / ticks);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
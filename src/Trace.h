@@ -0,0 +1,97 @@
+/*
+* A timeline of where the time goes, for catching the odd slow frame.
+*
+* TRACE_ZONE("name") at the top of a scope records when the scope was
+* entered and how long it took. While tracing is off a zone only reads one
+* flag; while it is on it reads the clock twice and stores one event, a few
+* tens of nanoseconds in all. On x86 with GCC or Clang the clock is the time
+* stamp counter, which is cheaper to read than the system clock; it is
+* converted to microseconds when the trace is written, by comparing both
+* clocks at startTracing() and at writeTrace(). Tracing is switched on and
+* off at runtime with startTracing() and stopTracing().
+*
+* Every thread records into a buffer of its own, so recording takes no lock
+* and threads never wait for each other. A buffer keeps the last
+* trace_buffer_size zones of its thread and overwrites the oldest ones when
+* it is full, so a long session only keeps its end. The buffers are created
+* on the first zone of a thread and live until the program exits.
+*
+* writeTrace() saves every zone recorded since the last startTracing() as
+* Chrome trace JSON, which Perfetto (ui.perfetto.dev) and chrome://tracing
+* show as one timeline per thread. It should be called while the other
+* threads are idle: a thread that keeps recording may overwrite the oldest
+* events of its buffer while they are written out.
+*
+* Zone names must be string literals; only the pointer is stored.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include "FrameScheduler.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#	define BILLIARD_TRACE_TSC
+#	include <x86intrin.h>
+#endif
+
+// zones kept per thread, a power of two
+const int trace_buffer_size = 1 << 16;
+
+extern std::atomic<bool> trace_enabled;
+
+void startTracing();
+void stopTracing();
+bool isTracing();
+void setTraceThreadName(const char *name);
+bool writeTrace(const char *path);
+
+void recordTraceZone(const char *name, long long start, long long duration);
+
+/*
+* The clock of the zones, in ticks of unspecified length.
+*/
+inline long long traceClock()
+{
+#ifdef BILLIARD_TRACE_TSC
+	return (long long) __rdtsc();
+#else
+	return monotonicNanoseconds();
+#endif
+}
+
+/*
+* Records its lifetime as a zone if tracing was on when it was created.
+*/
+class TraceZone
+{
+	public:
+		TraceZone(const char *name)
+			: name(name),
+			start(trace_enabled.load(std::memory_order_relaxed) ?
+				traceClock() : -1)
+		{
+		}
+
+		~TraceZone()
+		{
+			if (start >= 0)
+			{
+				recordTraceZone(name, start, traceClock() - start);
+			}
+		}
+
+	private:
+		TraceZone(const TraceZone &);
+		TraceZone &operator=(const TraceZone &);
+
+		const char *name;
+		long long start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+
+#endif
@@ -0,0 +1,101 @@
+/*
+* Hands the latest value from one thread to another without either of them
+* ever waiting.
+*
+* There are three slots: the writer owns one, the reader owns one and the
+* third sits in the middle. The writer fills its slot through back() and
+* publish() swaps it with the middle one; the reader's update() swaps its
+* slot with the middle one if something was published since. Each swap is
+* one atomic exchange of the middle index, which carries a flag saying
+* whether it holds a value the reader has not seen yet. So neither side
+* ever waits or copies the other's slot: a value published twice before the
+* reader looks is simply replaced, and the reader keeps drawing from its
+* own slot until a newer one arrives.
+*
+* Only one thread may write and only one may read. The slots are reused, so
+* a value that owns memory (a std::vector) stops allocating once all three
+* slots have grown to size.
+*/
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+template <class T>
+class TripleBuffer
+{
+	public:
+		TripleBuffer();
+
+		T &back();
+		void publish();
+
+		bool update();
+		const T &front() const;
+
+	private:
+		TripleBuffer(const TripleBuffer &);
+		TripleBuffer &operator=(const TripleBuffer &);
+
+		// set in the middle index while it holds an unread value
+		static const int fresh = 4;
+
+		T slots[3];
+		alignas(64) int backSlot; // of the writer
+		alignas(64) int frontSlot; // of the reader
+		alignas(64) std::atomic<int> middle;
+};
+
+template <class T>
+TripleBuffer<T>::TripleBuffer()
+	: backSlot(0), frontSlot(1), middle(2)
+{
+}
+
+/*
+* The writer's slot, to be filled before publish(). It holds whatever was
+* published some time before, not necessarily the last value.
+*/
+template <class T>
+T &TripleBuffer<T>::back()
+{
+	return slots[backSlot];
+}
+
+/*
+* Make the value in back() the newest one and take another slot to write.
+*/
+template <class T>
+void TripleBuffer<T>::publish()
+{
+	backSlot = middle.exchange(backSlot | fresh, std::memory_order_acq_rel) &
+		~fresh;
+}
+
+/*
+* Take the newest value into front(), if one was published since the last
+* call. Returns whether front() changed.
+*/
+template <class T>
+bool TripleBuffer<T>::update()
+{
+	if (!(middle.load(std::memory_order_relaxed) & fresh))
+	{
+		return false;
+	}
+
+	frontSlot = middle.exchange(frontSlot, std::memory_order_acq_rel) & ~fresh;
+	return true;
+}
+
+/*
+* The reader's slot: the newest value as of the last update().
+*/
+template <class T>
+const T &TripleBuffer<T>::front() const
+{
+	return slots[frontSlot];
+}
+
+#endif
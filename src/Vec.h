@@ -0,0 +1,235 @@
+/*
+* Small fixed size vectors for the physics.
+*
+* Vec2<T> and Vec3<T> only hold their components, so they are trivially
+* copyable, stay in registers and can be used in constant expressions. All
+* operators are inline free functions that return a new value; only the
+* compound assignments change their left operand.
+*
+* real is the scalar the physics computes in. It is float unless the build
+* defines BILLIARD_DOUBLE (the CMake option of the same name), which is meant
+* for offline analysis runs. The ball arrays stay float either way.
+*
+* With BILLIARD_VEC_SSE defined on a machine with SSE2 the arithmetic on
+* Vec2<double> is done on both components at once in one SSE register.
+*/
+
+#ifndef VEC_H
+#define VEC_H
+
+#include <math.h>
+#include <type_traits>
+
+#if defined(BILLIARD_VEC_SSE) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef BILLIARD_DOUBLE
+typedef double real;
+#else
+typedef float real;
+#endif
+
+// a vector shorter than this has no direction
+template <typename T>
+constexpr T vecEpsilon()
+{
+	return T(0.000001);
+}
+
+template <typename T>
+struct Vec2
+{
+	constexpr Vec2() : x(0), y(0) {}
+	constexpr Vec2(T x, T y) : x(x), y(y) {}
+
+	Vec2 &operator+=(const Vec2 &rhs) { x += rhs.x; y += rhs.y; return *this; }
+	Vec2 &operator-=(const Vec2 &rhs) { x -= rhs.x; y -= rhs.y; return *this; }
+	Vec2 &operator*=(T f) { x *= f; y *= f; return *this; }
+
+	T x, y;
+};
+
+template <typename T>
+struct Vec3
+{
+	constexpr Vec3() : x(0), y(0), z(0) {}
+	constexpr Vec3(T x, T y, T z) : x(x), y(y), z(z) {}
+
+	Vec3 &operator+=(const Vec3 &rhs) { x += rhs.x; y += rhs.y; z += rhs.z; return *this; }
+	Vec3 &operator-=(const Vec3 &rhs) { x -= rhs.x; y -= rhs.y; z -= rhs.z; return *this; }
+	Vec3 &operator*=(T f) { x *= f; y *= f; z *= f; return *this; }
+
+	T x, y, z;
+};
+
+static_assert(std::is_trivially_copyable<Vec2<real> >::value &&
+	sizeof(Vec2<real>) == 2 * sizeof(real), "Vec2 must stay a plain pair");
+static_assert(std::is_trivially_copyable<Vec3<real> >::value &&
+	sizeof(Vec3<real>) == 3 * sizeof(real), "Vec3 must stay a plain triple");
+
+/*****************************************************************************
+								Vec2
+******************************************************************************/
+
+template <typename T>
+constexpr Vec2<T> operator+(const Vec2<T> &lhs, const Vec2<T> &rhs)
+{
+	return Vec2<T>(lhs.x + rhs.x, lhs.y + rhs.y);
+}
+
+template <typename T>
+constexpr Vec2<T> operator-(const Vec2<T> &lhs, const Vec2<T> &rhs)
+{
+	return Vec2<T>(lhs.x - rhs.x, lhs.y - rhs.y);
+}
+
+template <typename T>
+constexpr Vec2<T> operator-(const Vec2<T> &v)
+{
+	return Vec2<T>(-v.x, -v.y);
+}
+
+template <typename T>
+constexpr Vec2<T> operator*(T f, const Vec2<T> &v)
+{
+	return Vec2<T>(f * v.x, f * v.y);
+}
+
+template <typename T>
+constexpr Vec2<T> operator*(const Vec2<T> &v, T f)
+{
+	return Vec2<T>(v.x * f, v.y * f);
+}
+
+template <typename T>
+constexpr T dot(const Vec2<T> &lhs, const Vec2<T> &rhs)
+{
+	return lhs.x * rhs.x + lhs.y * rhs.y;
+}
+
+/*
+* The vector turned a quarter counterclockwise.
+*/
+template <typename T>
+constexpr Vec2<T> perpendicular(const Vec2<T> &v)
+{
+	return Vec2<T>(-v.y, v.x);
+}
+
+template <typename T>
+inline T length(const Vec2<T> &v)
+{
+	return sqrt(dot(v, v));
+}
+
+/*
+* The vector scaled to length 1, or the zero vector if it has no direction.
+*/
+template <typename T>
+inline Vec2<T> normalized(const Vec2<T> &v)
+{
+	T l = length(v);
+	return l > vecEpsilon<T>() ? Vec2<T>(v.x / l, v.y / l) : Vec2<T>();
+}
+
+#if defined(BILLIARD_VEC_SSE) && defined(__SSE2__)
+
+// exact overloads win over the templates above
+
+inline Vec2<double> operator+(const Vec2<double> &lhs, const Vec2<double> &rhs)
+{
+	Vec2<double> result;
+	_mm_storeu_pd(&result.x, _mm_add_pd(_mm_loadu_pd(&lhs.x), _mm_loadu_pd(&rhs.x)));
+	return result;
+}
+
+inline Vec2<double> operator-(const Vec2<double> &lhs, const Vec2<double> &rhs)
+{
+	Vec2<double> result;
+	_mm_storeu_pd(&result.x, _mm_sub_pd(_mm_loadu_pd(&lhs.x), _mm_loadu_pd(&rhs.x)));
+	return result;
+}
+
+inline Vec2<double> operator*(double f, const Vec2<double> &v)
+{
+	Vec2<double> result;
+	_mm_storeu_pd(&result.x, _mm_mul_pd(_mm_set1_pd(f), _mm_loadu_pd(&v.x)));
+	return result;
+}
+
+inline Vec2<double> operator*(const Vec2<double> &v, double f)
+{
+	return f * v;
+}
+
+inline double dot(const Vec2<double> &lhs, const Vec2<double> &rhs)
+{
+	__m128d product = _mm_mul_pd(_mm_loadu_pd(&lhs.x), _mm_loadu_pd(&rhs.x));
+	return _mm_cvtsd_f64(_mm_add_sd(product, _mm_unpackhi_pd(product, product)));
+}
+
+#endif
+
+/*****************************************************************************
+								Vec3
+******************************************************************************/
+
+template <typename T>
+constexpr Vec3<T> operator+(const Vec3<T> &lhs, const Vec3<T> &rhs)
+{
+	return Vec3<T>(lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z);
+}
+
+template <typename T>
+constexpr Vec3<T> operator-(const Vec3<T> &lhs, const Vec3<T> &rhs)
+{
+	return Vec3<T>(lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z);
+}
+
+template <typename T>
+constexpr Vec3<T> operator-(const Vec3<T> &v)
+{
+	return Vec3<T>(-v.x, -v.y, -v.z);
+}
+
+template <typename T>
+constexpr Vec3<T> operator*(T f, const Vec3<T> &v)
+{
+	return Vec3<T>(f * v.x, f * v.y, f * v.z);
+}
+
+template <typename T>
+constexpr Vec3<T> operator*(const Vec3<T> &v, T f)
+{
+	return Vec3<T>(v.x * f, v.y * f, v.z * f);
+}
+
+template <typename T>
+constexpr T dot(const Vec3<T> &lhs, const Vec3<T> &rhs)
+{
+	return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+}
+
+template <typename T>
+constexpr Vec3<T> cross(const Vec3<T> &lhs, const Vec3<T> &rhs)
+{
+	return Vec3<T>(lhs.y * rhs.z - lhs.z * rhs.y,
+				lhs.z * rhs.x - lhs.x * rhs.z,
+				lhs.x * rhs.y - lhs.y * rhs.x);
+}
+
+template <typename T>
+inline T length(const Vec3<T> &v)
+{
+	return sqrt(dot(v, v));
+}
+
+template <typename T>
+inline Vec3<T> normalized(const Vec3<T> &v)
+{
+	T l = length(v);
+	return l > vecEpsilon<T>() ? Vec3<T>(v.x / l, v.y / l, v.z / l) : Vec3<T>();
+}
+
+#endif
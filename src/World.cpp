@@ -0,0 +1,938 @@
+#include <math.h>
+#include <string.h>
+#include "World.h"
+#include "BallMotion.h"
+#include "NarrowPhase.h"
+#include "Stats.h"
+#include "Trace.h"
+
+const float degree_to_radian = 3.14159265f/180.f;
+
+/*****************************************************************************
+							Helper Functions
+******************************************************************************/
+
+/*
+* Initialize the balls and set their locations
+*/
+void World::setupBalls(float radius, int numOfBalls)
+{
+	/* The balls are set up as follows
+						0
+
+
+
+
+
+						1
+					2		3
+				4		5		6
+			7		8		9		10
+		11 		12 		13 		14 		15
+
+	More balls continue the triangle with longer rows.
+
+	Note that the the radius of any three touching ball forms an
+	equalaterial triangle. The distance between each row is root_three * r.
+	The distance between each column is 2*r. A little extra room (0.0001) is
+	added inbetween all of the balls. */
+
+	balls.resize(numOfBalls);
+	int cloth = balls.addMaterial(cloth_friction, cushion_bounciness);
+
+	for (int i = 0; i < numOfBalls; i++)
+	{
+		balls.radius[i] = radius;
+		balls.id[i] = i;
+		balls.active[i] = 1;
+		balls.material[i] = cloth;
+	}
+
+	// add some extra room so the balls are not touching
+	radius += 0.0005f;
+
+	const float root_three = sqrt(3);
+
+	float x = table.length/4;
+	float y = table.length/4;
+	balls.x[0] = x; // cue ball
+	balls.y[0] = y;
+
+	x = x * 3;
+	int counter = 0;
+	int rowLength = 1;
+	for (int i = 1; i < numOfBalls; i++)
+	{
+		if (counter == rowLength) // i == 2, 4, 7, 11, 16, ...
+		{
+			x = x + root_three * radius;
+			y = y - radius;
+			counter = 0;
+			rowLength++;
+		}
+
+		balls.x[i] = x;
+		balls.y[i] = y + 2 * counter * radius;
+		counter++;
+	}
+}
+
+/*
+* Initialize the pockets and set their locations
+*/
+void World::setupPockets(float radius, int numOfPockets)
+{
+	/* The pockets are set up as following
+		P0------------------P1------------------P2
+		|										|
+		|										|
+		|										|
+		|										|
+		|										|
+		P3------------------P4------------------P5
+
+		There are 4 corner pockets and 2 side pockets.
+	*/
+
+	float x = 0.0f;
+	float y = 0.0f;
+
+	for (int i = 0; i < numOfPockets; i++)
+	{
+		if (i == 3)
+		{
+			x = 0.0f;
+			y = table.width;
+		}
+
+		table.pockets[i].x = x;
+		table.pockets[i].y = y;
+		table.pockets[i].radius = radius;
+		x = x + table.width;
+	}
+	table.bakeMouths();
+}
+
+/*
+* Index of the ball with the given id, or -1.
+*/
+int World::indexOf(int id) const
+{
+	for (int i = 0; i < balls.size(); i++)
+	{
+		if (balls.id[i] == id)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+* Move ball i for timePassed seconds, bouncing it off the cushions it
+* reaches on the way (see Table::sweep). Returns true and takes the ball off
+* the table if it went into a pocket.
+*/
+bool World::collideWithPockets(int i, float timePassed)
+{
+	if (motion == MOTION_SLIDE_ROLL)
+	{
+		return slideAndRoll(i, timePassed);
+	}
+
+	if (table.sweep(balls.x[i], balls.y[i], balls.radius[i], balls.vx[i],
+		balls.vy[i], timePassed, 1.0f, balls.id[i] == 0, scratched))
+	{
+		balls.active[i] = 0;
+		return true;
+	}
+
+	return false;
+}
+
+/*
+* collideWithPockets() for MOTION_SLIDE_ROLL. The ball goes where its slide
+* and roll take it in closed form; the cushions are found along the straight
+* line there, and every bounce turns the velocity at the end of the step as
+* it turns the velocity along that line. The spin is kept, so a ball that
+* rolled into a cushion slides away from it.
+*/
+bool World::slideAndRoll(int i, float timePassed)
+{
+	if (timePassed <= 0.0f)
+	{
+		return false;
+	}
+
+	float x = balls.x[i];
+	float y = balls.y[i];
+	float vx = balls.vx[i];
+	float vy = balls.vy[i];
+	const Material &material = balls.materialOf(i);
+	moveBall(x, y, vx, vy, balls.wx[i], balls.wy[i], material.friction,
+		timePassed);
+
+	float lineX = (x - balls.x[i]) / timePassed;
+	float lineY = (y - balls.y[i]) / timePassed;
+	float bouncedX = lineX;
+	float bouncedY = lineY;
+	bool dropped = table.sweep(balls.x[i], balls.y[i], balls.radius[i],
+		bouncedX, bouncedY, timePassed, material.bounciness, balls.id[i] == 0,
+		scratched);
+
+	balls.vx[i] = lineX != 0.0f ? vx * (bouncedX / lineX) : vx;
+	balls.vy[i] = lineY != 0.0f ? vy * (bouncedY / lineY) : vy;
+	if (dropped)
+	{
+		balls.active[i] = 0;
+	}
+
+	return dropped;
+}
+
+/*
+* Whether ball i is on the table and moving or spinning.
+*/
+bool World::isBallMoving(int i) const
+{
+	return balls.active[i] && (balls.vx[i] != 0.0f || balls.vy[i] != 0.0f ||
+		balls.wx[i] != 0.0f || balls.wy[i] != 0.0f);
+}
+
+/*****************************************************************************
+							Public Functions
+******************************************************************************/
+
+AdaptiveStepOptions::AdaptiveStepOptions()
+	: maxTravel(0.5f), contactTravel(0.1f), maxSubsteps(32)
+{
+}
+
+World::World(float length)
+	: table(length), broadPhase(new BruteForce()), awakeValid(false),
+	engine(ENGINE_FIXED_STEP), motion(MOTION_DAMPING), collisions(0),
+	substeps(0), scratched(false)
+{
+	setup();
+}
+
+World::World(const World &other)
+	: table(other.table), balls(other.balls),
+	broadPhase(other.broadPhase->clone()), hits(other.hits),
+	awake(other.awake), awakeRank(other.awakeRank),
+	awakeValid(other.awakeValid), engine(other.engine), motion(other.motion),
+	adaptive(other.adaptive), collisions(other.collisions),
+	substeps(other.substeps), events(other.events), scratched(other.scratched)
+{
+}
+
+World &World::operator=(const World &rhs)
+{
+	if (this != &rhs)
+	{
+		table = rhs.table;
+		balls = rhs.balls;
+		delete broadPhase;
+		broadPhase = rhs.broadPhase->clone();
+		hits = rhs.hits;
+		awake = rhs.awake;
+		awakeRank = rhs.awakeRank;
+		awakeValid = rhs.awakeValid;
+		engine = rhs.engine;
+		motion = rhs.motion;
+		adaptive = rhs.adaptive;
+		collisions = rhs.collisions;
+		substeps = rhs.substeps;
+		events = rhs.events;
+		scratched = rhs.scratched;
+	}
+
+	return *this;
+}
+
+World::~World()
+{
+	delete broadPhase;
+}
+
+/*
+* Rack the balls and place the pockets. Any previous state is discarded.
+*/
+void World::setup(int numOfBalls)
+{
+	setupBalls(ball_radius, numOfBalls);
+	setupPockets(pocket_radius, NUM_OF_POCKETS);
+	hits.resize(numOfBalls + 1);
+	events.invalidate();
+	awakeValid = false;
+	collisions = 0;
+	scratched = false;
+
+	memcpy(balls.lastX, balls.x, numOfBalls * sizeof(float));
+	memcpy(balls.lastY, balls.y, numOfBalls * sizeof(float));
+}
+
+/*
+* Fill the table with numOfBalls balls on a jittered lattice, each rolling
+* in a random direction at up to max_cue_speed. Ball 0 is still the cue
+* ball. If the table is too small only as many balls as fit are placed.
+* The same seed always gives the same table.
+*/
+void World::setupBallPit(int numOfBalls, unsigned int seed)
+{
+	const float spacing = 2 * ball_radius + 0.002f;
+	const int columns = (int) ((table.length - spacing) / spacing);
+	const int rows = (int) ((table.width - spacing) / spacing);
+
+	if (numOfBalls > columns * rows)
+	{
+		numOfBalls = columns * rows;
+	}
+
+	setup(numOfBalls);
+
+	// xorshift, so the layout does not depend on the C library
+	unsigned int state = seed ? seed : 1;
+	for (int i = 0; i < numOfBalls; i++)
+	{
+		float random[3];
+		for (int k = 0; k < 3; k++)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			random[k] = (state & 0xffffff) / (float) 0x1000000;
+		}
+
+		float jitter = (random[0] - 0.5f) * 0.001f;
+		balls.x[i] = balls.lastX[i] = spacing * (1 + i % columns) + jitter;
+		balls.y[i] = balls.lastY[i] = spacing * (1 + i / columns) - jitter;
+
+		float angle = random[1] * 360.0f * degree_to_radian;
+		float speed = random[2] * max_cue_speed;
+		balls.vx[i] = sin(angle) * speed;
+		balls.vy[i] = cos(angle) * speed;
+	}
+	events.invalidate();
+	awakeValid = false;
+}
+
+/*
+* Select the broad phase used to find colliding balls.
+*/
+void World::setBroadPhase(BroadPhaseType type)
+{
+	delete broadPhase;
+	broadPhase = BroadPhase::create(type, table, ball_radius);
+}
+
+BroadPhaseType World::broadPhaseType() const
+{
+	return broadPhase->type();
+}
+
+/*
+* Select the engine used by step() and runUntilRest(). The event driven
+* engine only knows MOTION_DAMPING, so selecting it selects that too.
+*/
+void World::setEngine(EngineType type)
+{
+	engine = type;
+	events.invalidate();
+	awakeValid = false;
+
+	if (engine == ENGINE_EVENT_DRIVEN)
+	{
+		setMotion(MOTION_DAMPING);
+	}
+}
+
+EngineType World::engineType() const
+{
+	return engine;
+}
+
+/*
+* Select how the balls slow down. Going back to MOTION_DAMPING stops every
+* spin. Returns false and changes nothing if the event driven engine, which
+* has no slide and roll, is selected.
+*/
+bool World::setMotion(MotionModel model)
+{
+	if (model != MOTION_DAMPING && engine == ENGINE_EVENT_DRIVEN)
+	{
+		return false;
+	}
+
+	motion = model;
+	if (motion == MOTION_DAMPING)
+	{
+		for (int i = 0; i < balls.size(); i++)
+		{
+			balls.wx[i] = 0.0f;
+			balls.wy[i] = 0.0f;
+		}
+	}
+	awakeValid = false;
+	return true;
+}
+
+MotionModel World::motionModel() const
+{
+	return motion;
+}
+
+/*
+* Set the bounds of the adaptive stepper. Replays do not record them, so a
+* replay of a world with other bounds than the default plays differently.
+*/
+void World::setAdaptiveStep(const AdaptiveStepOptions &options)
+{
+	adaptive = options;
+}
+
+const AdaptiveStepOptions &World::adaptiveStep() const
+{
+	return adaptive;
+}
+
+/*
+* The number of substeps the last step() took: those of the adaptive
+* stepper, 1 for the fixed stepper and 0 for the event driven engine.
+*/
+int World::lastSubsteps() const
+{
+	return substeps;
+}
+
+/*
+* Whether the cue ball reached a pocket mouth since the last shot.
+*/
+bool World::cueBallScratched() const
+{
+	return scratched;
+}
+
+const EventEngine &World::eventEngine() const
+{
+	return events;
+}
+
+WorldSnapshot::WorldSnapshot()
+	: table(table_length), broadPhase(BROAD_PHASE_BRUTE_FORCE),
+	engine(ENGINE_FIXED_STEP), motion(MOTION_DAMPING), scratched(false)
+{
+}
+
+/*
+* Save the state of the world. Reusing the same snapshot does not allocate
+* as long as the number of balls stays the same.
+*/
+void World::snapshot(WorldSnapshot &into) const
+{
+	into.table = table;
+	into.balls = balls;
+	into.broadPhase = broadPhase->type();
+	into.engine = engine;
+	into.motion = motion;
+	into.scratched = scratched;
+}
+
+/*
+* Go back to a saved state. Like restoreBalls(), this restarts the event
+* engine's prediction.
+*/
+void World::restore(const WorldSnapshot &from)
+{
+	// the grid is laid out for the table, so it has to follow a new one
+	bool sameTable = table.length == from.table.length &&
+		table.width == from.table.width;
+
+	table = from.table;
+	if (!sameTable || broadPhase->type() != from.broadPhase)
+	{
+		setBroadPhase(from.broadPhase);
+	}
+	engine = from.engine;
+	motion = from.motion;
+	restoreBalls(from.balls, from.scratched);
+}
+
+/*
+* Replace the balls with a saved state, e.g. a replay keyframe, and set
+* whether the cue ball has scratched since the last shot. The number of
+* balls may differ from the current one.
+*/
+void World::restoreBalls(const BallSystem &state, bool scratched)
+{
+	balls = state;
+	hits.resize(balls.size() + 1);
+	events.invalidate();
+	awakeValid = false;
+	collisions = 0;
+	this->scratched = scratched;
+}
+
+/*
+* Make the event engine predict again from the current state at the next
+* step, and the steppers forget which balls were awake and whether they
+* just collided. This only changes the result slightly, but afterwards the
+* simulation depends on nothing but the balls, so a world restored from the
+* same state at this moment continues exactly like this one.
+*/
+void World::restartPrediction()
+{
+	events.invalidate();
+	awakeValid = false;
+	collisions = 0;
+}
+
+/*
+* Convert the angle and power into a velocity for the cue ball.
+*
+* The angle is in degrees, starts at the top of the y-axis and goes
+* clockwise. The power is a fraction of max_cue_speed, or max_struck_speed
+* with MOTION_SLIDE_ROLL, between 0 and 1. The cue ball is struck in its
+* center, so it starts without spin.
+*/
+void World::shoot(float angle, float power)
+{
+	int cue = indexOf(0);
+	if (cue < 0)
+	{
+		return;
+	}
+
+	float speed = power * (motion == MOTION_SLIDE_ROLL ? max_struck_speed :
+		max_cue_speed);
+	balls.vx[cue] = sin(angle * degree_to_radian) * speed;
+	balls.vy[cue] = cos(angle * degree_to_radian) * speed;
+	balls.wx[cue] = 0.0f;
+	balls.wy[cue] = 0.0f;
+	events.invalidate();
+	awakeValid = false;
+	scratched = false;
+}
+
+/*
+* Advance the world by timePassed seconds with the selected engine. Returns
+* the number of balls that fell into a pocket during this step.
+*/
+int World::step(float timePassed)
+{
+	TRACE_ZONE("World::step");
+
+	// keep the old positions around for interpolation
+	memcpy(balls.lastX, balls.x, balls.size() * sizeof(float));
+	memcpy(balls.lastY, balls.y, balls.size() * sizeof(float));
+
+	int pocketed = 0;
+	if (engine == ENGINE_EVENT_DRIVEN)
+	{
+		pocketed = events.advance(balls, table, timePassed, scratched);
+		awakeValid = false;
+		substeps = 0;
+	}
+	else if (engine == ENGINE_ADAPTIVE_STEP)
+	{
+		pocketed = stepAdaptive(timePassed);
+	}
+	else
+	{
+		pocketed = stepFixed(timePassed);
+		substeps = 1;
+	}
+	COUNT_STAT(substeps, substeps);
+
+	COUNT_STAT(pocketed, pocketed);
+	return pocketed;
+}
+
+/*
+* Rebuild the list of awake balls from the velocities.
+*/
+void World::findAwakeBalls()
+{
+	const int n = balls.size();
+
+	awake.clear();
+	awakeRank.assign(n, -1);
+	for (int i = 0; i < n; i++)
+	{
+		if (isBallMoving(i))
+		{
+			awakeRank[i] = (int) awake.size();
+			awake.push_back(i);
+		}
+	}
+
+	awakeValid = true;
+}
+
+/*
+* Add a sleeping ball to the end of the awake list.
+*/
+void World::wake(int i)
+{
+	if (awakeRank[i] < 0)
+	{
+		awakeRank[i] = (int) awake.size();
+		awake.push_back(i);
+	}
+}
+
+/*
+* Advance by timePassed seconds in equal substeps of the fixed stepper,
+* as many as the fastest awake ball needs to travel no further than the
+* bound of AdaptiveStepOptions in each. The bound is the tighter one if
+* balls collided in the last substep, so a frame of the break is cut finely
+* while one with a lone rolling ball takes a single substep. Returns the
+* number of balls that fell into a pocket.
+*/
+int World::stepAdaptive(float timePassed)
+{
+	if (!awakeValid)
+	{
+		findAwakeBalls();
+	}
+
+	float maxSpeed = 0.0f;
+	for (size_t k = 0; k < awake.size(); k++)
+	{
+		int i = awake[k];
+		float speed = balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i];
+		if (speed > maxSpeed)
+		{
+			maxSpeed = speed;
+		}
+	}
+	maxSpeed = sqrt(maxSpeed);
+
+	float travel = (collisions > 0 ? adaptive.contactTravel :
+		adaptive.maxTravel) * ball_radius;
+	float needed = travel > 0.0f ? ceil(maxSpeed * timePassed / travel) :
+		adaptive.maxSubsteps;
+
+	substeps = 1;
+	if (needed > adaptive.maxSubsteps)
+	{
+		substeps = adaptive.maxSubsteps > 1 ? adaptive.maxSubsteps : 1;
+	}
+	else if (needed > 1.0f)
+	{
+		substeps = (int) needed;
+	}
+
+	const float substep = timePassed / substeps;
+	int pocketed = 0;
+	for (int s = 0; s < substeps; s++)
+	{
+		pocketed += stepFixed(substep);
+	}
+
+	return pocketed;
+}
+
+/*
+* Perform collision detecton and collision resolution for the awake balls
+* and also update their speed. Returns the number of balls that fell into
+* a pocket during this step.
+*
+* The step runs in phases, each of which is a single pass over the awake
+* balls: move them, bouncing them off the cushions and pockets at the moment
+* they reach them, resolve the ball-ball collisions and finally apply the
+* damping. Sleeping balls have no
+* velocity, so moving, bouncing and damping them would change nothing, and
+* two sleeping balls never collide. With every ball asleep the step does
+* nothing at all, not even update the broad phase.
+*/
+int World::stepFixed(float timePassed)
+{
+	const int n = balls.size();
+	float *vx = balls.vx;
+	float *vy = balls.vy;
+	const unsigned char *active = balls.active;
+	int pocketed = 0;
+
+	if (!awakeValid)
+	{
+		findAwakeBalls();
+	}
+
+	// nothing moves, so nothing can collide either, and the broad phase
+	// need not be brought up to date
+	if (awake.empty())
+	{
+		collisions = 0;
+		return 0;
+	}
+
+	// first, update the positions, stopping at each cushion on the way
+	for (size_t k = 0; k < awake.size(); k++)
+	{
+		if (collideWithPockets(awake[k], timePassed))
+		{
+			pocketed++;
+		}
+	}
+
+	// now check for collision with any other ball. The broad phase may
+	// reorder the balls, so the arrays and the awake list are read again
+	// afterwards. Resolving a collision moves ball i, so the remaining
+	// neighbours are tested again after each one. Collisions are rare enough
+	// that this costs next to nothing.
+	bool reordered;
+	{
+		TRACE_ZONE("broad phase");
+		reordered = broadPhase->update(balls);
+	}
+	if (reordered)
+	{
+		findAwakeBalls();
+	}
+	vx = balls.vx;
+	vy = balls.vy;
+	active = balls.active;
+
+	collisions = 0;
+	{
+		TRACE_ZONE("collisions");
+
+		int *hit = &hits[0];
+		if (2 * awake.size() > (size_t) n)
+		{
+			// most balls move, so every pair is tested once from the ball
+			// with the lower index
+			for (int i = 0; i < n; i++)
+			{
+				if (!active[i])
+				{
+					continue;
+				}
+
+				IndexRange ranges[2];
+				int numOfRanges = broadPhase->candidates(balls, i, ranges);
+
+				for (int r = 0; r < numOfRanges; r++)
+				{
+					COUNT_STAT(pairTests, ranges[r].end - ranges[r].begin);
+
+					int j = ranges[r].begin;
+					while (j < ranges[r].end &&
+						findOverlaps(balls, i, j, ranges[r].end, hit) > 0)
+					{
+						int other = hit[0];
+						if (active[other] &&
+							(awakeRank[i] >= 0 || awakeRank[other] >= 0))
+						{
+							collide(balls, i, other, timePassed);
+							COUNT_STAT(collisions, 1);
+							collisions++;
+							wake(i);
+							wake(other);
+						}
+						j = other + 1;
+					}
+				}
+			}
+		}
+		else
+		{
+			// only the awake balls look around. A pair of awake balls is
+			// resolved by the one earlier in the list; a sleeping ball that
+			// is hit wakes up and joins the end of the list, so its own
+			// neighbours are looked at in this step too
+			for (size_t k = 0; k < awake.size(); k++)
+			{
+				int i = awake[k];
+				if (!active[i])
+				{
+					continue;
+				}
+
+				IndexRange ranges[4];
+				int numOfRanges = broadPhase->neighbours(balls, i, ranges);
+
+				for (int r = 0; r < numOfRanges; r++)
+				{
+					COUNT_STAT(pairTests, ranges[r].end - ranges[r].begin);
+
+					int j = ranges[r].begin;
+					while (j < ranges[r].end &&
+						findOverlaps(balls, i, j, ranges[r].end, hit) > 0)
+					{
+						int other = hit[0];
+						int rank = awakeRank[other];
+						if (active[other] && (rank < 0 || rank > (int) k))
+						{
+							collide(balls, i, other, timePassed);
+							COUNT_STAT(collisions, 1);
+							collisions++;
+							wake(other);
+						}
+						j = other + 1;
+					}
+				}
+			}
+		}
+	}
+
+	// now update velocity. The damping is given per frame_time and scaled to
+	// the actual step, so the ball slows down the same at any step length.
+	// A sliding and rolling ball was already slowed down by its move.
+	// Balls that stop or were pocketed leave the awake list.
+	const bool damped = motion == MOTION_DAMPING;
+	const float damping = pow(velocity_damping, timePassed / frame_time);
+	size_t stillAwake = 0;
+	for (size_t k = 0; k < awake.size(); k++)
+	{
+		int i = awake[k];
+		awakeRank[i] = -1;
+		if (!active[i])
+		{
+			continue;
+		}
+
+		if (damped)
+		{
+			vx[i] = damping * vx[i];
+			vy[i] = damping * vy[i];
+			if (vx[i] * vx[i] + vy[i] * vy[i] < rest_speed * rest_speed)
+			{
+				vx[i] = 0.0f;
+				vy[i] = 0.0f;
+				continue;
+			}
+		}
+		else if (!isBallMoving(i))
+		{
+			continue;
+		}
+
+		awakeRank[i] = (int) stillAwake;
+		awake[stillAwake++] = i;
+	}
+	awake.resize(stillAwake);
+
+	return pocketed;
+}
+
+/*
+* Step the world until every ball has stopped or maxSteps have been taken.
+* Returns the number of steps taken. The event driven engine skips the steps
+* and jumps from event to event until the same point in time at most; it
+* returns the number of events it processed instead.
+*/
+int World::runUntilRest(float timeStep, int maxSteps)
+{
+	if (engine == ENGINE_EVENT_DRIVEN)
+	{
+		return events.advanceToRest(balls, table, timeStep * maxSteps,
+									scratched);
+	}
+
+	int steps = 0;
+
+	while (steps < maxSteps && isMoving())
+	{
+		step(timeStep);
+		steps++;
+	}
+
+	return steps;
+}
+
+bool World::isMoving() const
+{
+	if (awakeValid)
+	{
+		return !awake.empty();
+	}
+
+	for (int i = 0; i < balls.size(); i++)
+	{
+		if (isBallMoving(i))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+* Where ball i would be and how fast it would go after time seconds if it
+* hit nothing, in closed form at the same cost for any time. With
+* MOTION_DAMPING the speed decays continuously, as in the event driven
+* engine, until it falls below rest_speed.
+*/
+void World::predictBall(int i, float time, float &x, float &y, float &vx,
+						float &vy) const
+{
+	x = balls.x[i];
+	y = balls.y[i];
+	vx = balls.vx[i];
+	vy = balls.vy[i];
+
+	if (motion == MOTION_SLIDE_ROLL)
+	{
+		float wx = balls.wx[i];
+		float wy = balls.wy[i];
+		moveBall(x, y, vx, vy, wx, wy, balls.materialOf(i).friction, time);
+		return;
+	}
+
+	float speed = sqrt(vx * vx + vy * vy);
+	if (speed < rest_speed)
+	{
+		return;
+	}
+
+	// v(t) = v e^(-kt), so the ball rests at ln(speed / rest_speed) / k
+	const float k = -log(velocity_damping) / frame_time;
+	float stop = log(speed / rest_speed) / k;
+	float decay = exp(-k * (time < stop ? time : stop));
+
+	x += vx * (1.0f - decay) / k;
+	y += vy * (1.0f - decay) / k;
+	if (time < stop)
+	{
+		vx *= decay;
+		vy *= decay;
+	}
+	else
+	{
+		vx = vy = 0.0f;
+	}
+}
+
+int World::numOfBalls() const
+{
+	return balls.size();
+}
+
+int World::numOfPockets() const
+{
+	return NUM_OF_POCKETS;
+}
+
+bool World::isBallVisible(int i) const
+{
+	return balls.active[i] != 0;
+}
+
+const BallSystem &World::getBalls() const
+{
+	return balls;
+}
+
+const Pocket &World::pocket(int i) const
+{
+	return table.pockets[i];
+}
+
+const Table &World::getTable() const
+{
+	return table;
+}
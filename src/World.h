@@ -0,0 +1,200 @@
+/*
+* The simulation state of one billiard table.
+*
+* A World owns the table, the balls and the pockets and advances them in
+* time. It has no dependency on OpenGL or GLUT, so it can be used on machines
+* without a display, and every instance is independent of every other one:
+* any number of worlds can be created, copied and stepped in the same process.
+*
+* All lengths are in meters and all velocities in meters per second.
+*
+* snapshot() and restore() save and bring back the whole state. Both are
+* flat copies of the ball block and a few fields, and neither allocates once
+* the snapshot and the world have the same number of balls, so trying out
+* "what if" branches from the same position costs next to nothing.
+*
+* The number of balls is chosen at setup time. The standard game racks
+* NUM_OF_BALLS; setupBallPit fills the table with as many balls as asked for
+* and pairs a large count with one of the broad phases from BroadPhase.h.
+* Balls are reordered by the broad phase, so the index of a ball in
+* getBalls() can change between steps; BallSystem::id does not.
+*
+* Three engines advance the world. The fixed stepper moves all balls by the
+* time passed to step() and then resolves whatever overlaps; the adaptive
+* stepper splits every step into as many substeps of the fixed stepper as
+* the fastest ball and the contacts between the balls need (see
+* AdaptiveStepOptions); the event driven engine (see EventEngine.h) jumps
+* from contact to contact and is exact for any step length. All of them
+* bounce a ball off a cushion at the moment it reaches it, so no step is too
+* long to keep the balls on the table.
+*
+* Most of the time only a few balls roll while the rest lie still. The fixed
+* stepper keeps a list of the moving ("awake") balls and only moves, bounces,
+* tests and damps those; a ball at rest sleeps until an awake ball hits it,
+* so a step costs about the number of moving balls times their neighbours,
+* whatever the number of balls on the table. Pocketed balls are in no loop.
+*/
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <vector>
+#include "BallSystem.h"
+#include "BroadPhase.h"
+#include "EventEngine.h"
+#include "Table.h"
+
+#define NUM_OF_BALLS 16
+
+const int fps = 25;
+const float frame_time = 1.0f / fps;
+
+const float table_length = 2.7f;
+const float ball_radius = 0.028575f;
+const float pocket_radius = 0.055f;
+
+// speed of the cue ball at full power
+const float max_cue_speed = 0.6f;
+
+// fraction of its speed a ball keeps per frame_time, and the speed below
+// which it stops
+const float velocity_damping = 0.99f;
+const float rest_speed = 0.00001f;
+
+// the material of the standard balls and the speed of the cue ball at full
+// power, for MOTION_SLIDE_ROLL; that is a hard break, which needs short
+// steps or ENGINE_ADAPTIVE_STEP
+const float cloth_friction = 0.2f;
+const float cushion_bounciness = 0.8f;
+const float max_struck_speed = 4.0f;
+
+enum EngineType
+{
+	ENGINE_FIXED_STEP,
+	ENGINE_EVENT_DRIVEN,
+	ENGINE_ADAPTIVE_STEP
+};
+
+/*
+* How the balls slow down between contacts. MOTION_DAMPING takes a fixed
+* share of their speed every frame_time and leaves the cushions perfectly
+* elastic. MOTION_SLIDE_ROLL slides and rolls them with the friction of
+* their material and bounces them off the cushions with its bounciness (see
+* BallMotion.h); the steppers then move each ball in closed form, exactly
+* for any step length between two contacts.
+*/
+enum MotionModel
+{
+	MOTION_DAMPING,
+	MOTION_SLIDE_ROLL
+};
+
+/*
+* How finely ENGINE_ADAPTIVE_STEP divides a step. The bounds are the
+* distance the fastest ball may travel in one substep, in ball radii: a
+* quiet table, where a slow ball rolls alone, takes whole steps, while the
+* break is cut into short substeps as long as the balls keep colliding.
+*/
+struct AdaptiveStepOptions
+{
+	AdaptiveStepOptions();
+
+	float maxTravel; // while no balls collide
+	float contactTravel; // after a substep with a collision
+	int maxSubsteps;
+};
+
+/*
+* A saved state of a World, see World::snapshot(). It only holds plain data:
+* the table, the ball arrays (one block, see BallSystem) and a few flags.
+*/
+class WorldSnapshot
+{
+	public:
+		WorldSnapshot();
+
+	private:
+		friend class World;
+
+		Table table;
+		BallSystem balls;
+		BroadPhaseType broadPhase;
+		EngineType engine;
+		MotionModel motion;
+		bool scratched;
+};
+
+class World
+{
+	public:
+		World(float length = table_length);
+		World(const World &other);
+		World &operator=(const World &rhs);
+		~World();
+
+		void setup(int numOfBalls = NUM_OF_BALLS);
+		void setupBallPit(int numOfBalls, unsigned int seed = 1);
+		void setBroadPhase(BroadPhaseType type);
+		BroadPhaseType broadPhaseType() const;
+		void setEngine(EngineType type);
+		EngineType engineType() const;
+		bool setMotion(MotionModel model);
+		MotionModel motionModel() const;
+		void setAdaptiveStep(const AdaptiveStepOptions &options);
+		const AdaptiveStepOptions &adaptiveStep() const;
+		int lastSubsteps() const;
+		const EventEngine &eventEngine() const;
+
+		void snapshot(WorldSnapshot &into) const;
+		void restore(const WorldSnapshot &from);
+		void restoreBalls(const BallSystem &state, bool scratched);
+		void restartPrediction();
+
+		void shoot(float angle, float power);
+		int step(float timePassed);
+		int runUntilRest(float timeStep, int maxSteps);
+		bool collideWithPockets(int i, float timePassed);
+		void predictBall(int i, float time, float &x, float &y, float &vx,
+						float &vy) const;
+
+		bool isMoving() const;
+		bool cueBallScratched() const;
+		int numOfBalls() const;
+		int numOfPockets() const;
+		bool isBallVisible(int i) const;
+		const BallSystem &getBalls() const;
+		const Pocket &pocket(int i) const;
+		const Table &getTable() const;
+
+	private:
+		void setupBalls(float radius, int numOfBalls);
+		void setupPockets(float radius, int numOfPockets);
+		int indexOf(int id) const;
+		int stepFixed(float timePassed);
+		int stepAdaptive(float timePassed);
+		bool slideAndRoll(int i, float timePassed);
+		bool isBallMoving(int i) const;
+		void findAwakeBalls();
+		void wake(int i);
+
+		Table table;
+		BallSystem balls;
+		BroadPhase *broadPhase;
+		std::vector<int> hits;
+
+		// the balls that are on the table and moving, and the position of
+		// every ball in that list or -1 if it sleeps. Rebuilt from the
+		// velocities when awakeValid is false.
+		std::vector<int> awake;
+		std::vector<int> awakeRank;
+		bool awakeValid;
+		EngineType engine;
+		MotionModel motion;
+		AdaptiveStepOptions adaptive;
+		int collisions; // in the last substep of the fixed stepper
+		int substeps; // in the last step
+		EventEngine events;
+		bool scratched;
+};
+
+#endif
@@ -1,3 +1,4 @@
+#include <string.h>
 #include "Billiard.h"
 
 extern const int window_width;
@@ -5,6 +6,12 @@ extern const int window_height;
 
 int main( int argc, char* argv[])
 {
+	// -export <replay> <file> renders a replay to raw video without a window
+	if (argc == 4 && strcmp(argv[1], "-export") == 0)
+	{
+		return exportReplay(argv[2], argv[3]) ? 0 : 1;
+	}
+
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
 	glutInitWindowSize(window_width, window_height);
@@ -13,8 +20,21 @@ int main( int argc, char* argv[])
 	setupRenderingContext();
 	setupGame();
 
+	// -record <file> saves the game, -replay <file> plays a saved one,
+	// -trace records a timeline from the start
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-record") == 0 && i + 1 < argc)
+			startRecording(argv[++i]);
+		else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc)
+			startReplay(argv[++i]);
+		else if (strcmp(argv[i], "-trace") == 0)
+			startTrace();
+	}
+	startSimulation();
+
 	glutDisplayFunc(display);
-	glutIdleFunc(update);
+	glutTimerFunc(0, timer, 0);
 	glutReshapeFunc(reshape);
 	glutKeyboardFunc(keyboard);
 	glutSpecialFunc(specialKeys);